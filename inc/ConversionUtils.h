@@ -43,8 +43,16 @@ class ConversionUtils
 public:
 	static void AppendToUtf8BufferL(const TDesC & aThingToAdd, TDes8 & aWhereToAdd);
 	static void AppendToUtf8BufferEncodedL(const TDesC & aThingToAdd, TDes8 & aWhereToAdd);
+	static void AppendToUtf8BufferEncodedL(const TDesC8 & aThingToAdd, TDes8 & aWhereToAdd);
 	static void AppendToUnicodeBufferL(const TDesC8 & aThingToAdd, TDes & aWhereToAdd);
 	static void AppendToUnicodeBufferDecodedL(const TDesC8 & aThingToAdd, TDes & aWhereToAdd);
+	static HBufC8 * ConvertToUtf8L(const TDesC & aText);
+	static HBufC * ConvertToUnicodeL(const TDesC8 & aText);
+	static void DecodeReferences(TDes8 & aText);
+	static TInt DecodeReference(const TDesC8 & aReference, TUint & aCode);
+	static TInt AppendReference(const TDesC8 & aReference, TDes8 & aTarget);
+	static void AppendUtf8(TDes8 & aTarget, TUint aCode);
+	static TInt FindByte(const TDesC8 & aData, TUint8 aByte);
 	};
 
 } // ajj
@@ -34,11 +34,16 @@ namespace ajj
 {
 
 class MXmlVisitor;
+class CXmlStringPool;
 
 /**
  * Defines key-value -pairs, used in XML parsing.
- * Stores the key-value pairs as 16bit descriptors, but accepts
- * also 8 bit descriptors as parameters (from xml files).
+ * Stores the key-value pairs in the width they were set in, 8 bit
+ * keys and UTF-8 values from xml files, and converts them to the other
+ * width only when queried with Key() and Value(), or Key8() and Value8().
+ * The key and namespace may also be interned in a CXmlStringPool, shared
+ * with the other attributes and elements of the document. Objects
+ * allocated in a CXmlArena are read only, see CXmlElement.
  * @author Antti Juustila
  * @version $Revision: 1155 $
  */
@@ -61,6 +66,9 @@ public:
 	IMPORT_C const TDesC & NameSpace() const;
 	IMPORT_C const TDesC & Key() const;
 	IMPORT_C const TDesC & Value() const;
+	IMPORT_C const TDesC8 & NameSpace8() const;
+	IMPORT_C const TDesC8 & Key8() const;
+	IMPORT_C const TDesC8 & Value8() const;
 
 	IMPORT_C void SetNameSpaceL(const TDesC & aNameSpace);
 	IMPORT_C void SetNameSpaceL(const TDesC8 & aNameSpace);
@@ -68,12 +76,17 @@ public:
 	IMPORT_C void SetValueL(const TDesC & aValue);
 	IMPORT_C void SetKeyL(const TDesC8 & aKey);
 	IMPORT_C void SetValueL(const TDesC8 & aValue);
+	IMPORT_C void SetNameSpaceL(const TDesC8 & aNameSpace, CXmlStringPool & aPool);
+	IMPORT_C void SetKeyL(const TDesC8 & aKey, CXmlStringPool & aPool);
 	
 	IMPORT_C void GetAsTextL(TDes8 & aBuffer);
 
 	static TInt Compare(const CKeyValue & aFirst, const CKeyValue & aSecond);
+	TBool Matches(const TDesC8 & aNameSpace, const TDesC8 & aKey, const CXmlStringPool * aPool,
+			const HBufC8 * aPooledNameSpace, const HBufC8 * aPooledKey) const;
 	
 	TInt ApproximateTextLength() const;
+	const RAllocator * Heap() const;
 
 	IMPORT_C virtual void AcceptL(MXmlVisitor & aVisitor);
 	
@@ -82,14 +95,35 @@ private:
 	void ConstructL(const TDesC8 & aKey, const TDesC8 & aValue);
 	void ConstructL(const TDesC & aKey, const TDesC & aValue);
 	void ConstructL(const TDesC8 & aNameSpace, const TDesC8 & aKey, const TDesC8 & aValue);
+	void PrepareValueL() const;
+	void PrepareValue8L() const;
+	void DoPrepareValue8L() const;
+	void CheckHeapL() const;
+	void ResetNameSpace();
+	void ResetKey();
+	void UsePool(CXmlStringPool & aPool);
 	
 private:
-	/** The namespace of the key. */
-	HBufC							*iNameSpace;
-	/** The value of the key. */
-	HBufC					 		*iKey;
-	/** The value. */
-	HBufC 						*iValue;
+	/** The namespace of the key, widened from iNameSpace8 when first queried. */
+	mutable HBufC					*iNameSpace;
+	/** The namespace as 8 bit, narrowed from iNameSpace when first queried. */
+	mutable HBufC8					*iNameSpace8;
+	/** The value of the key, widened from iKey8 when first queried. */
+	mutable HBufC			 		*iKey;
+	/** The key as 8 bit, narrowed from iKey when first queried. */
+	mutable HBufC8			 		*iKey8;
+	/** The value, converted from iValue8 when first queried. */
+	mutable HBufC 				*iValue;
+	/** The value as UTF-8, converted from iValue when first queried. */
+	mutable HBufC8 				*iValue8;
+	/** The pool of the interned key and namespace, kept open, 0 if none. */
+	CXmlStringPool					*iPool;
+	/** ETrue if iKey8 is interned in iPool, and not owned. */
+	TBool							iKeyIsPooled;
+	/** ETrue if iNameSpace8 is interned in iPool, and not owned. */
+	TBool							iNameSpaceIsPooled;
+	/** The heap the object was created in, e.g. the heap of a CXmlArena. */
+	RAllocator						*iHeap;
 };
 
 /** A typedef to easier handling of key value pair arrays. */
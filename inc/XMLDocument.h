@@ -39,6 +39,7 @@ namespace ajj
 {
 
 class MXmlVisitor;
+class CXmlArena;
 
 /**
  * This class holds XML elements and document information and can be
@@ -61,6 +62,8 @@ public:
 	IMPORT_C void GetElementsL(RXmlElementArray & aArray);
 	IMPORT_C void AddElementsL(RXmlElementArray & aArray);
 	IMPORT_C void AddElementL(const CXmlElement * aElement);
+	IMPORT_C void AdoptBufferL(HBufC8 * aBuffer);
+	IMPORT_C void AdoptArenaL(RXmlElementArray & aArray, CXmlArena * aArena);
 	IMPORT_C void ExportToFileL(const TDesC & aFileName) const;
 	IMPORT_C void ExportToFileL(RFs & aFs, const TDesC & aFileName) const;
 	IMPORT_C HBufC8 * ExportToUtf8L() const;
@@ -73,6 +76,7 @@ public:
 	
 private:
 	void ConstructL(RXmlElementArray & aArray);
+	TBool InArena(const CXmlElement * aElement) const;
 
 private:
 	/**
@@ -83,6 +87,14 @@ private:
 	 * Does the document own the elements or not.
 	 */
 	TBool iOwnsElements;
+	/**
+	 * The XML the values of the elements are views into, see AdoptBufferL.
+	 */
+	RPointerArray<HBufC8> iBuffers;
+	/**
+	 * The arenas elements of the document are allocated in, see AdoptArenaL.
+	 */
+	RPointerArray<CXmlArena> iArenas;
 	};
 
 } // org
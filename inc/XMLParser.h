@@ -73,6 +73,76 @@ namespace ajj
 
 //  Class Definitions
 class CXmlDocument;
+class MXmlByteSource;
+class CXmlTokenizer;
+class CXmlPathFilter;
+class CXmlStringPool;
+class CXmlArena;
+
+/** Default size of the window used when reading files in pieces. */
+const TInt KXmlDefaultFileWindowSize = 32768;
+/** Default size of the piece of XML parsed in one step. */
+const TInt KXmlDefaultParseStep = 2048;
+/** Default count of pieces a document is parsed in at the same time, see EXmlParseParallel. */
+const TInt KXmlDefaultParallelism = 2;
+/** Smallest file parsed in parallel, see EXmlParseParallel. */
+const TInt KXmlMinParallelSize = 131072;
+
+/**
+ * Options controlling how CXmlParser reads its input. The options
+ * are bit flags and can be combined, see CXmlParser::SetOptions.
+ */
+enum TXmlParserOptions
+	{
+	/** Files are read into memory as a whole before parsing. */
+	EXmlParseDefault = 0x00,
+	/** Files are read and parsed in windows of bounded size, so
+	 * the whole file is never in memory. */
+	EXmlParseStreamFile = 0x01,
+	/** Files that are directly addressable (e.g. in ROM) are parsed in
+	 * place without copying. Other files are read as without this option. */
+	EXmlParseMapFile = 0x02,
+	/** Large files are read into memory as a whole, split between the records
+	 * of the element containing most of the document (e.g. the Placemarks of
+	 * a KML Document), and the pieces parsed at the same time in worker threads,
+	 * see CXmlParser::SetParallelism. Files that cannot be split are parsed as
+	 * without this option. Takes precedence over EXmlParseStreamFile. */
+	EXmlParseParallel = 0x04,
+	/** The values of the elements and attributes are kept as UTF-8, and
+	 * converted to Unicode and decoded only when first queried, see
+	 * CXmlElement::SetValueLazyL. The pieces of a file parsed in parallel
+	 * are decoded at once. */
+	EXmlParseLazyValues = 0x08,
+	/** As EXmlParseLazyValues, and in addition, the values of the elements
+	 * of a file read into memory as a whole or mapped are views into the file
+	 * instead of copies, see CXmlElement::SetValueViewL. Only values that had
+	 * references decoded, or were split by the end of a block, are copied.
+	 * GetElementsL(CXmlDocument&) hands the file to the document, which keeps
+	 * it as long as the elements. The views of elements got with
+	 * GetElementsL(RXmlElementArray&), or handed to a MXmlRecordObserver,
+	 * are copied when they are handed out, see CXmlElement::CopyValueViewsL.
+	 * With EXmlTokenizerPlatform, all values are copied. */
+	EXmlParseViewValues = 0x10,
+	/** The elements, their names and values are allocated in a CXmlArena
+	 * instead of the heap of the thread. GetElementsL(CXmlDocument&) hands
+	 * the arena to the document, which frees the whole tree at once, and
+	 * GetElementsL(RXmlElementArray&) cannot be used. The elements are read
+	 * only: their setters leave with KErrNotSupported, see CXmlElement.
+	 * Not used with a MXmlSaxHandler or a MXmlRecordObserver, nor for
+	 * the pieces of a file parsed in parallel. */
+	EXmlParseArena = 0x20
+	};
+
+/**
+ * The tokenizers CXmlParser can use, see CXmlParser::NewL.
+ */
+enum TXmlTokenizer
+	{
+	/** The Symbian XML parser (Xml::CParser) for text/xml. */
+	EXmlTokenizerPlatform,
+	/** The tokenizer of this library, CXmlTokenizer. */
+	EXmlTokenizerNative
+	};
 
 /**
  * Observer class for getting parsing events.
@@ -104,13 +174,102 @@ public:
 	virtual void ParsingFinishedL(TInt aError) = 0;
 };
 
+/**
+ * Handler of the parsing events, for clients that consume the document in
+ * one pass, e.g. count, filter or forward it, see CXmlParser::SetSaxHandler.
+ * The names are namespace-resolved, and the content and attribute values
+ * decoded to UTF-8. The descriptors are valid only during the call.
+ * @version $Revision: $
+ */
+class MXmlSaxHandler
+{
+public:
+	virtual ~MXmlSaxHandler() {};
+	/** Called at the start of an element.
+	 * @param aUri The namespace URI of the element, empty if none.
+	 * @param aPrefix The namespace prefix of the element, empty if none.
+	 * @param aLocalName The name of the element without the prefix.
+	 * @param aAttributes The attributes of the element. */
+	virtual void StartElementL(const TDesC8 & aUri, const TDesC8 & aPrefix,
+			const TDesC8 & aLocalName, const Xml::RAttributeArray & aAttributes) = 0;
+	/** Called at the end of an element.
+	 * @param aUri The namespace URI of the element, empty if none.
+	 * @param aPrefix The namespace prefix of the element, empty if none.
+	 * @param aLocalName The name of the element without the prefix. */
+	virtual void EndElementL(const TDesC8 & aUri, const TDesC8 & aPrefix,
+			const TDesC8 & aLocalName) = 0;
+	/** Called with the content of the current element. The content of
+	 * one element may come in several calls.
+	 * @param aBytes The content. */
+	virtual void ContentL(const TDesC8 & aBytes) = 0;
+	/** Called before the start of the element declaring a namespace.
+	 * @param aPrefix The namespace prefix, empty for the default namespace.
+	 * @param aUri The namespace URI. */
+	virtual void StartPrefixMappingL(const TDesC8 & aPrefix, const TDesC8 & aUri) = 0;
+	/** Called after the end of the element that declared a namespace.
+	 * @param aPrefix The namespace prefix. */
+	virtual void EndPrefixMappingL(const TDesC8 & aPrefix) = 0;
+};
+
+/** What CXmlParser does with an element, see MXmlElementHook. */
+enum TXmlElementAction
+	{
+	/** The element is parsed as usual. */
+	EXmlElementParse,
+	/** The element is skipped with its content and child elements. */
+	EXmlElementSkip
+	};
+
+/**
+ * Hook called at the start of each element, for clients that are not
+ * interested in some elements, e.g. a large ExtendedData or an HTML
+ * description of a KML file, see CXmlParser::SetElementHook.
+ * @version $Revision: $
+ */
+class MXmlElementHook
+{
+public:
+	virtual ~MXmlElementHook() {};
+	/** Called at the start of an element, before the element is created
+	 * or forwarded to the MXmlSaxHandler.
+	 * @param aUri The namespace URI of the element, empty if none.
+	 * @param aPrefix The namespace prefix of the element, empty if none.
+	 * @param aLocalName The name of the element without the prefix.
+	 * @param aAttributes The attributes of the element.
+	 * @returns EXmlElementSkip to skip the element, EXmlElementParse to parse it. */
+	virtual TXmlElementAction StartElementL(const TDesC8 & aUri, const TDesC8 & aPrefix,
+			const TDesC8 & aLocalName, const Xml::RAttributeArray & aAttributes) = 0;
+};
+
+/**
+ * Observer of the records of a document, for clients that process a
+ * document one record at a time, e.g. one Placemark of a KML file,
+ * see CXmlParser::SetRecordObserverL.
+ * @version $Revision: $
+ */
+class MXmlRecordObserver
+{
+public:
+	virtual ~MXmlRecordObserver() {};
+	/** Called when a record element has ended. The record is no longer
+	 * in the tree of the parser.
+	 * @param aRecord The record with its child elements. The observer
+	 * takes the ownership of it, also if this method leaves. With
+	 * EXmlParseViewValues, the values of the record have been copied from
+	 * the XML parsed, so the record stays valid after the parser has parsed
+	 * another document or has been destroyed. */
+	virtual void RecordParsedL(CXmlElement * aRecord) = 0;
+};
+
 /**
  * Parser for XML content, producing CXmlElement objects in a container.<br />
  * Usage:<br />
  * <ul>
  * <li>Define a client class which implements the MXmlParserObserver interface</li>
  * <li>Create parser using NewL, passing the interface implementor as a parameter</li>
- * <li>Call either ParseXmlFileL or ParseXmlBuffer, depending.</li>
+ * <li>Call either ParseXmlFileL or ParseXmlBuffer, depending, or feed the XML
+ * in pieces as it arrives by calling FeedL and finally FinishL. Other inputs
+ * can be parsed by implementing MXmlByteSource and calling ParseSourceL.</li>
  * <li>As the interface methods FragmentParsedL and/or ParsingFinishedL are called,
  * retrieve the already created objects by....</li>
  * <li>...calling GetElementsL.</li>
@@ -139,6 +298,7 @@ class CXmlParser : public CActive, public Xml::MContentHandler
 	{
 public:
 	IMPORT_C static CXmlParser* NewL(MXmlParserObserver & aObserver);
+	IMPORT_C static CXmlParser* NewL(MXmlParserObserver & aObserver, TXmlTokenizer aTokenizer);
 	IMPORT_C ~CXmlParser();
 
 public:
@@ -147,8 +307,26 @@ public:
 	IMPORT_C TInt ParseXmlFileL(const TDesC & aFileName);
 	IMPORT_C TInt ParseXmlBufferSyncL(const TDesC8 & aBuffer);
 	IMPORT_C TInt ParseXmlFileSyncL(const TDesC & aFileName);
+	IMPORT_C TInt ParseSourceL(MXmlByteSource & aSource);
+	IMPORT_C TInt ParseSourceSyncL(MXmlByteSource & aSource);
 	IMPORT_C void GetElementsL(RXmlElementArray & aArray);
 	IMPORT_C void GetElementsL(CXmlDocument & aDocument);
+	IMPORT_C void SetOptions(TUint aOptions);
+	IMPORT_C TUint Options() const;
+	IMPORT_C void SetFileWindowSize(TInt aWindowSize);
+	IMPORT_C void SetSliceBudget(TInt aMicroSeconds, TInt aMaxBytes = 0);
+	IMPORT_C void SetParallelism(TInt aPieceCount);
+	IMPORT_C void FeedL(const TDesC8 & aChunk);
+	IMPORT_C TInt FinishL();
+	IMPORT_C void SetObserver(MXmlParserObserver & aObserver);
+	IMPORT_C void SetSaxHandler(MXmlSaxHandler * aHandler);
+	IMPORT_C void SetRecordObserverL(MXmlRecordObserver & aObserver,
+			const TDesC & aNameSpace, const TDesC & aName);
+	IMPORT_C void SetRecordObserver(MXmlRecordObserver & aObserver, TInt aDepth);
+	IMPORT_C void ClearRecordObserver();
+	IMPORT_C void SetPathFilter(CXmlPathFilter * aFilter);
+	IMPORT_C void SetElementHook(MXmlElementHook * aHook);
+	IMPORT_C void Reset();
 	
 public:
 	// From MContentHandler
@@ -179,6 +357,9 @@ public:
 
 protected:
 	virtual void ParseNextFragmentL();
+	TInt ParseBlockL();
+	void AdaptStepSize(TInt aBytes, TInt aMicroSeconds);
+	TInt MicroSecondsSince(TUint32 aStartCount) const;
 	virtual void ParsingEndedL();
 	
 	// From CActive
@@ -188,21 +369,81 @@ protected:
 	
 private:
 	CXmlParser(MXmlParserObserver & aObserver);
-	void ConstructL();
+	void ConstructL(TXmlTokenizer aTokenizer);
+	void TokenizeBeginL();
+	void TokenizeL(const TDesC8 & aXml);
+	void TokenizeEndL();
 
 	void AddToNameSpacesListL(const TDesC8 & aUri, const TDesC8 & aPrefix);
+	TBool IsRecord(const CXmlElement & aElement) const;
+	void SkipElement();
+	void PrepareParsingL();
+	void ClearDocument();
+	CXmlArena * ReleaseArena();
+	void AddElementL(const TDesC8 & aPrefix, const TDesC8 & aLocalName,
+			const Xml::RAttributeArray & aAttributes, TInt aAttributeCount);
+	void AccumulateContentL(const TDesC8 & aBytes);
+	void FlushContentL();
+	void DoFlushContentL();
+	void DoAddToNameSpacesListL(const TDesC8 & aUri, const TDesC8 & aPrefix);
+	void MoveNameSpacesL(CXmlElement & aElement);
+	TInt ParseOwnedSourceL(MXmlByteSource * aSource, TInt aBlockSize, const TDesC8 & aInput = KNullDesC8);
+	TBool IsInInput(const TDesC8 & aData) const;
+	TBool ParseInParallelL(const TDesC8 & aXml);
+	void StartParsingL(MXmlByteSource & aSource, TInt aBlockSize);
+	void RequestBlock();
+	void CancelSourceRead();
+	void CloseSource();
 
 private:
-	/** Observer to notify of parsing. */
-	MXmlParserObserver & iObserver;
+	/** Observer to notify of parsing, not owned. */
+	MXmlParserObserver * iObserver;
+	/** Handler the parsing events are forwarded to instead of building
+	 * the elements, 0 if not used. Not owned. */
+	MXmlSaxHandler * iSaxHandler;
+	/** Observer the records are handed to, 0 if not used. Not owned. */
+	MXmlRecordObserver * iRecordObserver;
+	/** Namespace of the record elements, 0 if records are recognized by depth. */
+	HBufC * iRecordNameSpace;
+	/** Name of the record elements, 0 if records are recognized by depth. */
+	HBufC8 * iRecordName;
+	/** Depth of the record elements, the topmost element is at 0. */
+	TInt iRecordDepth;
+	/** Selects the elements created, 0 if all are. Not owned. */
+	CXmlPathFilter * iPathFilter;
+	/** Hook deciding which elements are skipped, 0 if not used. Not owned. */
+	MXmlElementHook * iElementHook;
+	/** Depth inside the element being skipped, 0 when not skipping. */
+	TInt iSkipDepth;
+	/** Pool the names of the elements and attributes are interned in,
+	 * created for the first element, and shared with the elements. */
+	CXmlStringPool * iNamePool;
+	/** Arena the elements are allocated in, see EXmlParseArena, 0 if not used. */
+	CXmlArena * iArena;
 	/** Place to get the XML content when parsing from file. */
 	HBufC8 * iFileBuffer;
-	/** A pointer descriptor to the KML content, used in parsing. */
-	TPtrC8 iXmlString;
+	/** The XML being parsed when it stays in memory, so that values can be
+	 * views into it, see EXmlParseViewValues. Empty otherwise. */
+	TPtrC8 iInput;
+	/** The source the XML is read from, 0 if not parsing a source. */
+	MXmlByteSource * iSource;
+	/** The source created by the parser itself, deleted when done. */
+	MXmlByteSource * iOwnedSource;
+	/** ETrue while a block requested from iSource with iStatus is
+	 * outstanding, and not yet waited for by the active scheduler. */
+	TBool iReadPending;
 	/** File server session for reading KML files. */
 	RFs iFs;
-	/** The Symbian XML parser. */
+	/** Size of the window in bytes when parsing a file in windows. */
+	TInt iFileWindowSize;
+	/** Options for parsing, see TXmlParserOptions. */
+	TUint iOptions;
+	/** Count of pieces a file is parsed in with EXmlParseParallel. */
+	TInt iParallelism;
+	/** The Symbian XML parser, 0 if iTokenizer is used. */
 	Xml::CParser * iXmlParser;
+	/** The native tokenizer, 0 if iXmlParser is used. */
+	CXmlTokenizer * iTokenizer;
 	/** If something went wrong in parsing, the error code should be here. */
 	TInt iError;
 
@@ -225,14 +466,34 @@ private:
 	CXmlElement * iCurrentElement;
 	/** Used when parsing of content is done in pieces. */
 	CXmlElement * iPreviousElement;
-	/** Current index to the fragment of descriptor under parsing now. */
-	TInt		  iCurrentParseIndex;
-	/** How big fragment is parsed in one step. */
-	const TInt 	  iBytesToParseInStep;
+	/** Content of iPreviousElement not yet given to it, gathered from
+	 * the pieces and set as its value at once, see FlushContentL. */
+	RBuf8 iContent;
+	/** Content of iPreviousElement not yet given to it, with
+	 * EXmlParseViewValues while the pieces follow each other in the XML
+	 * parsed. Given to it as a view, see AccumulateContentL. */
+	TPtrC8 iContentView;
+	/** ETrue if iPreviousElement has a value iContent is added to. */
+	TBool iContentIsAddition;
+	/** Count of the elements started, but not yet ended. */
+	TInt iDepth;
+	/** How big fragment is requested from the source in one step. Adapted
+	 * to the measured throughput when parsing in time budgeted slices. */
+	TInt 	  iBytesToParseInStep;
+	/** Time budget of one slice of async parsing in microseconds, 0 if not used. */
+	TInt		  iSliceTimeBudget;
+	/** Byte budget of one slice of async parsing, 0 if not used. */
+	TInt		  iSliceByteBudget;
+	/** Frequency of the fast counter used to measure the slices, in Hz. */
+	TInt		  iFastCounterFrequency;
+	/** ETrue if the fast counter counts up, EFalse if it counts down. */
+	TBool		  iFastCounterCountsUp;
 	/** Controls the parsing, enables canceling. */
 	TBool		  iIsParsing;
 	/** Controls whether to do the parsing synchronously. */
 	TBool iDoSynchronously;
+	/** ETrue while a document is being fed in with FeedL. */
+	TBool iIsFeeding;
 #ifdef USE_DEBUGLOGGER
 	/** object used for debug logging. */
 	oy::tol::CDebugLogger * iLogger;
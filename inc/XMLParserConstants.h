@@ -34,6 +34,12 @@ _LIT(KCDataEnd, "]]>");
 _LIT8(KCDataStart8, "<![CDATA[");
 _LIT8(KCDataEnd8, "]]>");
 _LIT8(KXmlNs, "xmlns");
+_LIT(KXmlNs16, "xmlns");
+_LIT8(KXmlNsPrefix8, "xmlns:");
+_LIT8(KCommentStart8, "<!--");
+_LIT8(KCommentEnd8, "-->");
+_LIT8(KProcessingInstructionEnd8, "?>");
+_LIT8(KXmlDeclarationTarget8, "xml");
 
 _LIT(KLTReference, "&lt;");
 _LIT(KGTReference, "&gt;");
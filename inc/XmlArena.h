@@ -0,0 +1,82 @@
+#ifndef __XMLARENA_H__
+#define __XMLARENA_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+namespace org
+{
+namespace ajj
+{
+
+/** Default largest size of an arena, reserved as address space only. */
+const TInt KXmlDefaultArenaMaxSize = 0x800000;
+/** Size the memory of an arena is committed in. */
+const TInt KXmlArenaGrowBy = 0x10000;
+
+/**
+ * Private heap the elements of a document are allocated from, see
+ * the option EXmlParseArena of CXmlParser. The heap is a chunk heap,
+ * so the elements are allocated from large blocks of memory, and destroying
+ * the arena frees them all at once without visiting them, and without
+ * fragmenting the heap of the thread.<br />
+ * The parser allocates in the arena by making it the heap of the thread
+ * while it builds the elements, see SwitchHeapL. The elements remember the
+ * heap they were created in, and the memory they allocate later for
+ * converting their names and values is allocated in the same heap. Other
+ * changes to the elements of an arena, and moving them out of it, must be
+ * done while the arena is the heap of the thread. The elements of an arena
+ * are never destroyed one by one, but with the arena.
+ * @version $Revision: $
+ */
+class CXmlArena : public CBase
+	{
+public:
+	IMPORT_C static CXmlArena * NewL(TInt aMaxSize = KXmlDefaultArenaMaxSize);
+	IMPORT_C ~CXmlArena();
+	IMPORT_C RAllocator & Heap();
+	IMPORT_C TBool Owns(const TAny * aCell) const;
+
+	IMPORT_C static RAllocator * SwitchHeap(RAllocator & aHeap);
+	IMPORT_C static RAllocator * SwitchHeapL(RAllocator & aHeap);
+	IMPORT_C static void SwitchHeapBack(RAllocator * aPrevious);
+
+private:
+	CXmlArena(TInt aMaxSize);
+	void ConstructL();
+
+private:
+	/** The heap, at the start of its own chunk. */
+	RHeap * iHeap;
+	/** The size of the address space reserved for the heap. */
+	const TInt iMaxSize;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLARENA_H__
@@ -0,0 +1,151 @@
+#ifndef __XMLBATCHPARSER_H__
+#define __XMLBATCHPARSER_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+#include "XMLParser.h"
+
+namespace org
+{
+namespace ajj
+{
+
+class CXmlDocument;
+class CXmlBatchItem;
+class CXmlBatchWorker;
+
+/** Default count of worker threads of CXmlBatchParser. */
+const TInt KXmlDefaultBatchThreads = 2;
+
+/**
+ * Observer class for getting the results of CXmlBatchParser.
+ * The methods are called in the thread of the batch parser.
+ */
+class MXmlBatchObserver
+	{
+public:
+	virtual ~MXmlBatchObserver() {};
+	/** Called when an input of the batch has been parsed. The inputs
+	 * finish in the order the workers happen to complete them.
+	 * @param aIndex The index of the input, in the order they were added.
+	 * @param aDocument The document parsed, owned by the observer from now on.
+	 * 0 if the parsing failed.
+	 * @param aError KErrNone, or the error the parsing of the input failed with. */
+	virtual void DocumentParsedL(TInt aIndex, CXmlDocument * aDocument, TInt aError) = 0;
+	/** Called when all of the inputs of the batch have been parsed.
+	 * @param aError KErrNone, or the error the batch failed with. */
+	virtual void BatchFinishedL(TInt aError) = 0;
+	};
+
+/**
+ * Parses a batch of XML files and buffers on a pool of worker threads,
+ * each thread parsing with a CXmlParser of its own. The threads take the
+ * next input from the shared queue of the batch whenever they are done
+ * with the previous one, so a few large inputs do not hold back the rest.
+ * The threads share the heap of the batch parser, so the documents they
+ * create are handed to the observer as they are.<br />
+ * Usage:<br />
+ * <ul>
+ * <li>Create the batch parser, giving the observer and the count of threads.</li>
+ * <li>Add the inputs with AddFileL and AddBufferL.</li>
+ * <li>Start the batch with StartL, and get the documents in
+ * MXmlBatchObserver::DocumentParsedL.</li>
+ * </ul>
+ * A batch parser parses one batch. Deleting it, or calling Cancel, stops
+ * the batch after the inputs being parsed have been parsed.
+ * @version $Revision: $
+ */
+class CXmlBatchParser : public CActive
+	{
+public:
+	IMPORT_C static CXmlBatchParser * NewL(MXmlBatchObserver & aObserver,
+			TInt aThreadCount = KXmlDefaultBatchThreads,
+			TXmlTokenizer aTokenizer = EXmlTokenizerPlatform);
+	IMPORT_C ~CXmlBatchParser();
+
+	IMPORT_C void AddFileL(const TDesC & aFileName);
+	IMPORT_C void AddBufferL(const TDesC8 & aBuffer);
+	IMPORT_C TInt Count() const;
+	IMPORT_C void StartL();
+
+private:
+	friend class CXmlBatchWorker;
+
+	CXmlBatchParser(MXmlBatchObserver & aObserver, TInt aThreadCount, TXmlTokenizer aTokenizer);
+	void ConstructL();
+	void AddItemL(CXmlBatchItem * aItem);
+	void Arm();
+	void StopWorkers();
+
+	// Called by the worker threads.
+	TInt TakeItem();
+	void ParseItemL(CXmlParser & aParser, TInt aIndex);
+	void ItemDone(TInt aIndex, TInt aError);
+	void WorkerExited(TInt aError);
+
+	// From CActive
+	virtual void DoCancel();
+	virtual void RunL();
+	virtual TInt RunError(TInt aError);
+
+private:
+	/** Observer to notify of the documents, not owned. */
+	MXmlBatchObserver & iObserver;
+	/** The count of worker threads wanted. */
+	const TInt iThreadCount;
+	/** The tokenizer the parsers of the workers use. */
+	const TXmlTokenizer iTokenizer;
+	/** The inputs of the batch, in the order they were added. */
+	RPointerArray<CXmlBatchItem> iItems;
+	/** The worker threads. */
+	RPointerArray<CXmlBatchWorker> iWorkers;
+	/** Indexes of the inputs parsed, in the order they were done. Has
+	 * room for all the inputs, so the workers never allocate it. */
+	RArray<TInt> iDone;
+	/** Count of the parsed inputs handed to the observer. */
+	TInt iDelivered;
+	/** Guards the members shared with the worker threads. */
+	RFastLock iLock;
+	/** Handle to this thread, for completing iStatus from the workers. */
+	RThread iThread;
+	/** Index of the next input to parse, shared. */
+	TInt iNextItem;
+	/** Count of the worker threads not yet exited, shared. */
+	TInt iRunningWorkers;
+	/** ETrue while iStatus waits for the workers to complete it, shared. */
+	TBool iArmed;
+	/** ETrue when the batch has been cancelled, shared. */
+	TBool iCancelled;
+	/** ETrue when the batch has been started. */
+	TBool iStarted;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLBATCHPARSER_H__
@@ -0,0 +1,205 @@
+#ifndef __XMLBYTESOURCE_H__
+#define __XMLBYTESOURCE_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+#include <f32file.h> // RFs, RFile
+
+class RReadStream;
+
+namespace org
+{
+namespace ajj
+{
+
+/**
+ * Interface for the input of CXmlParser. The parser pulls the XML
+ * from the source in blocks: it requests a block with ReadBlock, and when
+ * the request completes, gets the block with Block() and immediately
+ * requests the next one before parsing the block it got. A source can thus
+ * read the next block while the previous one is parsed, or hand out
+ * pieces of memory it already has without copying them.<br />
+ * A block stays valid until the ReadBlock request following it completes.
+ * The end of the input is signalled by an empty block.
+ * @version $Revision: $
+ */
+class MXmlByteSource
+	{
+public:
+	virtual ~MXmlByteSource() {};
+	/** Requests the next block of the input. The request may be
+	 * completed before this method returns.
+	 * @param aMaxLength The largest block the caller wants.
+	 * @param aStatus Completed with KErrNone when the block is available,
+	 * or with an error code. */
+	virtual void ReadBlock(TInt aMaxLength, TRequestStatus & aStatus) = 0;
+	/** Returns the block of the last completed request, empty at the end of the input. */
+	virtual TPtrC8 Block() const = 0;
+	/** Cancels an outstanding ReadBlock request, which then completes with KErrCancel. */
+	virtual void CancelRead() = 0;
+	};
+
+/**
+ * Byte source handing out pieces of a descriptor in memory, without
+ * copying them. Also used for files mapped to memory, see MapFileL.
+ * @version $Revision: $
+ */
+class CXmlMemorySource : public CBase, public MXmlByteSource
+	{
+public:
+	IMPORT_C static CXmlMemorySource * NewL(const TDesC8 & aBuffer);
+	IMPORT_C static CXmlMemorySource * MapFileL(RFs & aFs, const TDesC & aFileName);
+	IMPORT_C ~CXmlMemorySource();
+	IMPORT_C TPtrC8 Buffer() const;
+
+public:
+	// From MXmlByteSource
+	virtual void ReadBlock(TInt aMaxLength, TRequestStatus & aStatus);
+	virtual TPtrC8 Block() const;
+	virtual void CancelRead();
+
+private:
+	CXmlMemorySource(const TDesC8 & aBuffer);
+
+private:
+	/** The whole input, owned by the client. */
+	TPtrC8 iBuffer;
+	/** The block handed out last. */
+	TPtrC8 iBlock;
+	/** Offset of the next block in iBuffer. */
+	TInt iOffset;
+	};
+
+/**
+ * Byte source reading a file in windows. The next window is read into
+ * one buffer while the previous window is parsed from the other, so
+ * disk reads and parsing proceed at the same time.
+ * @version $Revision: $
+ */
+class CXmlFileSource : public CBase, public MXmlByteSource
+	{
+public:
+	IMPORT_C static CXmlFileSource * NewL(RFs & aFs, const TDesC & aFileName, TInt aWindowSize);
+	IMPORT_C ~CXmlFileSource();
+
+public:
+	// From MXmlByteSource
+	virtual void ReadBlock(TInt aMaxLength, TRequestStatus & aStatus);
+	virtual TPtrC8 Block() const;
+	virtual void CancelRead();
+
+private:
+	CXmlFileSource();
+	void ConstructL(RFs & aFs, const TDesC & aFileName, TInt aWindowSize);
+
+private:
+	/** The file being read. */
+	RFile iFile;
+	/** Buffer holding the block handed out last. */
+	HBufC8 * iBlockBuffer;
+	/** Buffer the next block is read into. */
+	HBufC8 * iReadBuffer;
+	/** Descriptor the read goes to, must live until the read completes. */
+	TPtr8 iReadPtr;
+	};
+
+/**
+ * Byte source reading a stream, e.g. a stream from a store or
+ * a memory buffer. Stream reads are synchronous, so each request
+ * completes before ReadBlock returns.
+ * @version $Revision: $
+ */
+class CXmlStreamSource : public CBase, public MXmlByteSource
+	{
+public:
+	IMPORT_C static CXmlStreamSource * NewL(RReadStream & aStream, TInt aBlockSize);
+	IMPORT_C ~CXmlStreamSource();
+
+public:
+	// From MXmlByteSource
+	virtual void ReadBlock(TInt aMaxLength, TRequestStatus & aStatus);
+	virtual TPtrC8 Block() const;
+	virtual void CancelRead();
+
+private:
+	CXmlStreamSource(RReadStream & aStream);
+	void ConstructL(TInt aBlockSize);
+	void ReadBlockL(TInt aMaxLength);
+
+private:
+	/** The stream being read, owned by the client. */
+	RReadStream & iStream;
+	/** Buffer holding the block handed out last. */
+	HBufC8 * iBlockBuffer;
+	/** Buffer the next block is read into. */
+	HBufC8 * iReadBuffer;
+	};
+
+/**
+ * Byte source for data pushed to it by its owner, e.g. received from
+ * a socket. A ReadBlock request stays outstanding until the owner pushes
+ * more data with PushL, or ends the input with End.
+ * @version $Revision: $
+ */
+class CXmlPushSource : public CBase, public MXmlByteSource
+	{
+public:
+	IMPORT_C static CXmlPushSource * NewL();
+	IMPORT_C ~CXmlPushSource();
+	IMPORT_C void PushL(const TDesC8 & aData);
+	IMPORT_C void End();
+
+public:
+	// From MXmlByteSource
+	virtual void ReadBlock(TInt aMaxLength, TRequestStatus & aStatus);
+	virtual TPtrC8 Block() const;
+	virtual void CancelRead();
+
+private:
+	CXmlPushSource();
+	void CompleteRead(TInt aError);
+
+private:
+	/** Data pushed, but not yet handed out. */
+	RBuf8 iPending;
+	/** The block handed out last. */
+	RBuf8 iBlock;
+	/** Buffer the next block is copied into, swapped with iBlock, so
+	 * the block being parsed is not overwritten. */
+	RBuf8 iReadBuffer;
+	/** The outstanding request, 0 if none. */
+	TRequestStatus * iReadStatus;
+	/** The largest block the outstanding request wants. */
+	TInt iMaxLength;
+	/** ETrue when the owner has ended the input. */
+	TBool iEnded;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLBYTESOURCE_H__
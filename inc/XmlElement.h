@@ -35,6 +35,7 @@ namespace ajj
 {
 
 class MXmlVisitor;
+class CXmlStringPool;
 
 /** Maximum length of the namespace name. */
 const TInt KMaxXmlNameSpaceLength = 20;
@@ -80,6 +81,17 @@ public:
 /**
  * Defines XML elements. CXmlElement has attributes (CKeyValue pairs) as well
  * as child CXmlElement objects. Each element has a namespace, a name and a value.
+ * The name and value are kept in the width they were set in, so the 8 bit
+ * names and UTF-8 values of parsing are stored as such, and converted to
+ * 16 bit only if queried with Name() and Value(). Name8() and Value8()
+ * give them without conversion. The name may also be interned in a
+ * CXmlStringPool shared with the rest of the document, and then the 8 bit
+ * lookups Element() and Attribute() compare names by address.<br />
+ * Elements parsed with EXmlParseArena are allocated in a CXmlArena and
+ * are read only: the setters and the methods adding attributes and children
+ * leave with KErrNotSupported, and RemoveChild panics. Children and
+ * attributes must be created in the same heap as the element they are
+ * added to, otherwise the adding methods leave with KErrNotSupported.
  * @todo Change the namespace to a dynamic buffer too, as name and value are.
  * @author Antti Juustila
  * @version $Revision: 1590 $
@@ -104,13 +116,20 @@ public:
 	IMPORT_C const TDesC & Name() const;
 	IMPORT_C const TDesC & NameSpace() const;
 	IMPORT_C const TDesC & Value() const;
+	IMPORT_C const TDesC8 & Name8() const;
+	IMPORT_C const TDesC8 & Value8() const;
 	
 	IMPORT_C void SetNameL(const TDesC & aName);
 	IMPORT_C void SetNameL(const TDesC8 & aName);
+	IMPORT_C void SetNameL(const TDesC8 & aName, CXmlStringPool & aPool);
 	IMPORT_C void SetValueL(const TDesC & aValue);
 	IMPORT_C void SetValueL(const TDesC8 & aValue);
 	IMPORT_C void AddToValueL(const TDesC & aValue);
 	IMPORT_C void AddToValueL(const TDesC8 & aValue);
+	IMPORT_C void SetValueLazyL(const TDesC8 & aValue);
+	IMPORT_C void SetValueViewL(const TDesC8 & aValue);
+	IMPORT_C void AddToValueLazyL(const TDesC8 & aValue);
+	IMPORT_C void DecodeValueL() const;
 	IMPORT_C void SetNameSpace(const TDesC & aNameSpace);
 	IMPORT_C void SetNameSpace(const TDesC8 & aNameSpace);
 
@@ -122,8 +141,11 @@ public:
 	IMPORT_C CXmlElement * Child(TInt aChild);
 	IMPORT_C const CXmlElement * Child(TInt aChild) const;
 	IMPORT_C void AddElementL(const CXmlElement * aElement);
+	IMPORT_C CXmlElement * RemoveChild(TInt aChild);
 	IMPORT_C const CXmlElement * Element(const TDesC & aNameSpace, const TDesC & aKey) const;
 	IMPORT_C CXmlElement * Element(const TDesC & aNameSpace, const TDesC & aKey);
+	IMPORT_C const CXmlElement * Element(const TDesC8 & aNameSpace, const TDesC8 & aName) const;
+	IMPORT_C CXmlElement * Element(const TDesC8 & aNameSpace, const TDesC8 & aName);
 
 	// Attribute management
 	IMPORT_C TInt AttributeCount() const;
@@ -131,6 +153,8 @@ public:
 	IMPORT_C const CKeyValue * Attribute(TInt aIndex) const;
 	IMPORT_C CKeyValue * Attribute(const TDesC & aNameSpace, const TDesC & aKey);
 	IMPORT_C const CKeyValue * Attribute(const TDesC & aNameSpace, const TDesC & aKey) const;
+	IMPORT_C CKeyValue * Attribute(const TDesC8 & aNameSpace, const TDesC8 & aKey);
+	IMPORT_C const CKeyValue * Attribute(const TDesC8 & aNameSpace, const TDesC8 & aKey) const;
 	IMPORT_C const TDesC & AttributeKeyValue(const TDesC & aNameSpace, const TDesC & aKey) const;
 	IMPORT_C void AddAttributeL(CKeyValue * aKeyValue);
 	IMPORT_C void AddAttributesL(RKeyValuePairs & aKeyValues);
@@ -141,6 +165,8 @@ public:
 	
 	IMPORT_C void GetAsTextL(TDes8 & aBuffer);
 	IMPORT_C TInt ApproximateTextLength() const;
+
+	void CopyValueViewsL();
 	
 	IMPORT_C virtual void AcceptL(MXmlVisitor & aVisitor);
 	
@@ -151,15 +177,40 @@ private:
 	void ConstructL(const TDesC8 & aNameSpace, const TDesC8 & aName, const TDesC8 & aValue);
 	
 	void Trim();
+	void TrimValue8L();
+	void PrepareValue8L() const;
+	void DoPrepareValue8L() const;
+	void DoDecodeValueL() const;
+	void ResetValue8() const;
+	void CheckHeapL() const;
+	TBool HasName(const TDesC & aName) const;
+	void ResetName();
+	const CXmlElement * FindElement(const TDesC8 & aNameSpace, const TDesC8 & aName,
+			const CXmlStringPool * aPool, const HBufC8 * aPooledName) const;
+	const CKeyValue * FindAttribute(const TDesC8 & aNameSpace, const TDesC8 & aKey,
+			const CXmlStringPool * aPool, const HBufC8 * aPooledNameSpace, const HBufC8 * aPooledKey) const;
 	
 private:
 	// TODO make iNameSpace HBufC
 	/** Namespace of the element. */
 	TBufC<KMaxXmlNameSpaceLength>   iNameSpace;
-	/** Name of the element. */
-	HBufC							*iName;
-	/** The value for the element. */
-	HBufC							*iValue;
+	/** Name of the element, widened from iName8 when first queried. */
+	mutable HBufC					*iName;
+	/** Name of the element as 8 bit, narrowed from iName when first queried. */
+	mutable HBufC8					*iName8;
+	/** The pool iName8 is interned in, kept open, 0 if none. */
+	CXmlStringPool					*iPool;
+	/** ETrue if iName8 is interned in iPool, and not owned. */
+	TBool							iNameIsPooled;
+	/** The value for the element, converted from iValue8 when first queried. */
+	mutable HBufC					*iValue;
+	/** The value as UTF-8, in iValueBuffer8 or in the XML parsed, see
+	 * SetValueViewL. Converted from iValue when first queried. */
+	mutable TPtrC8					iValue8;
+	/** The storage of iValue8 if owned, 0 if iValue8 is a view. */
+	mutable HBufC8					*iValueBuffer8;
+	/** ETrue if the references in iValue8 have been decoded, see SetValueLazyL. */
+	mutable TBool					iValue8IsDecoded;
 	/** ETrue, if the value is CDATA. */
 	TBool							iValueIsCData;
 	/** Contains the attributes of the XML element in key-value -pairs. */
@@ -169,6 +220,8 @@ private:
 	
 	/** Points to the parent element of this object. Used in parsing. */
 	CXmlElement					* iParent;
+	/** The heap the element was created in, e.g. the heap of a CXmlArena. */
+	RAllocator					* iHeap;
 };
 
 
@@ -0,0 +1,249 @@
+#ifndef __XMLFLATDOCUMENT_H__
+#define __XMLFLATDOCUMENT_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+#include "XMLParser.h" // MXmlSaxHandler
+
+namespace org
+{
+namespace ajj
+{
+
+class CXmlElement;
+class CXmlDocument;
+class CXmlStringPool;
+class CXmlFlatDocument;
+class MXmlFlatVisitor;
+class MXmlVisitor;
+
+/**
+ * An element of CXmlFlatDocument, in document order. The descendants of
+ * the element are the elements after it, up to iEnd, so the first child
+ * of an element with children is the next element.
+ */
+class TXmlFlatNode
+	{
+public:
+	/** Namespace prefix, pooled, 0 if none. */
+	const HBufC8 * iNameSpace;
+	/** Name, pooled. */
+	const HBufC8 * iName;
+	/** Index of the parent, KErrNotFound for a topmost element. */
+	TInt iParent;
+	/** Index of the next sibling, KErrNotFound for the last child. */
+	TInt iNextSibling;
+	/** Index after the last descendant. */
+	TInt iEnd;
+	/** Count of the children. */
+	TInt iChildCount;
+	/** Index of the first attribute. The attributes of the descendants follow. */
+	TInt iFirstAttribute;
+	/** Count of the attributes. */
+	TInt iAttributeCount;
+	/** Offset of the value in the text of the document. */
+	TInt iValueOffset;
+	/** Length of the value, as UTF-8 with the references decoded. */
+	TInt iValueLength;
+	/** ETrue, if the value is CDATA. */
+	TBool iValueIsCData;
+	/** The value as 16 bit, converted on the first query, 0 until then. */
+	mutable HBufC * iWideValue;
+	};
+
+/** An attribute of CXmlFlatDocument. */
+class TXmlFlatAttribute
+	{
+public:
+	/** Namespace prefix, pooled, 0 if none. */
+	const HBufC8 * iNameSpace;
+	/** Key, pooled. */
+	const HBufC8 * iKey;
+	/** Offset of the value in the text of the document. */
+	TInt iValueOffset;
+	/** Length of the value, as UTF-8. */
+	TInt iValueLength;
+	/** The value as 16 bit, converted on the first query, 0 until then. */
+	mutable HBufC * iWideValue;
+	};
+
+/** A pooled name of CXmlFlatDocument as 16 bit, converted on the first query. */
+class TXmlFlatWideName
+	{
+public:
+	/** The pooled name. */
+	const HBufC8 * iName;
+	/** The name as 16 bit, owned. */
+	HBufC * iWideName;
+	};
+
+/**
+ * Refers to an element of CXmlFlatDocument, with the queries of
+ * CXmlElement. A null element, see IsNull, is returned by the queries
+ * when no element is found. Valid as long as the document is not changed.
+ * The 16 bit queries convert on the first query, as CXmlElement does,
+ * and the results stay in the document until it is reset. Code written
+ * for CXmlElement trees can also be given a copy, see CopyLC.
+ * @version $Revision: $
+ */
+class TXmlFlatElement
+	{
+public:
+	IMPORT_C TXmlFlatElement(const CXmlFlatDocument & aDocument, TInt aIndex);
+	IMPORT_C TBool IsNull() const;
+	IMPORT_C TInt Index() const;
+
+	IMPORT_C const TDesC & NameSpace() const;
+	IMPORT_C const TDesC & Name() const;
+	IMPORT_C const TDesC & Value() const;
+	IMPORT_C const TDesC8 & NameSpace8() const;
+	IMPORT_C const TDesC8 & Name8() const;
+	IMPORT_C TPtrC8 Value8() const;
+	IMPORT_C TBool ValueIsCData() const;
+
+	IMPORT_C TInt ChildCount() const;
+	IMPORT_C TXmlFlatElement Child(TInt aChild) const;
+	IMPORT_C TXmlFlatElement Parent() const;
+	IMPORT_C TXmlFlatElement Element(const TDesC8 & aNameSpace, const TDesC8 & aName) const;
+
+	IMPORT_C TInt AttributeCount() const;
+	IMPORT_C const TDesC & AttributeNameSpace(TInt aIndex) const;
+	IMPORT_C const TDesC & AttributeKey(TInt aIndex) const;
+	IMPORT_C const TDesC & AttributeValue(TInt aIndex) const;
+	IMPORT_C const TDesC & AttributeKeyValue(const TDesC & aNameSpace, const TDesC & aKey) const;
+	IMPORT_C const TDesC8 & AttributeNameSpace8(TInt aIndex) const;
+	IMPORT_C const TDesC8 & AttributeKey8(TInt aIndex) const;
+	IMPORT_C TPtrC8 AttributeValue8(TInt aIndex) const;
+	IMPORT_C TPtrC8 AttributeKeyValue8(const TDesC8 & aNameSpace, const TDesC8 & aKey) const;
+
+	IMPORT_C CXmlElement * CopyLC() const;
+
+private:
+	const TXmlFlatNode & Node() const;
+	TInt AttributeEnd() const;
+
+private:
+	/** The document of the element. */
+	const CXmlFlatDocument * iDocument;
+	/** Index of the element, KErrNotFound if null. */
+	TInt iIndex;
+	};
+
+/**
+ * Compact representation of a parsed document. The elements are kept in
+ * document order in one array, linked with the indices of their parents and
+ * next siblings, and the attributes in another array. The names are interned
+ * in a CXmlStringPool and the values kept in one buffer, so a document
+ * takes a few allocations however many elements it has, and finding
+ * elements, visiting and exporting them reads the arrays from start to end.
+ * <br />
+ * The document is built by parsing into it, setting it as the
+ * MXmlSaxHandler of CXmlParser, or from CXmlElement trees with AppendL.
+ * The elements are queried through TXmlFlatElement. A MXmlVisitor written
+ * for CXmlDocument runs on the document too, see AcceptL.
+ * @version $Revision: $
+ */
+class CXmlFlatDocument : public CBase, public MXmlSaxHandler
+	{
+public:
+	IMPORT_C static CXmlFlatDocument * NewL();
+	IMPORT_C static CXmlFlatDocument * NewLC();
+	IMPORT_C ~CXmlFlatDocument();
+
+	IMPORT_C void AppendL(const CXmlElement & aElement);
+	IMPORT_C void AppendL(const CXmlDocument & aDocument);
+	IMPORT_C void Reset();
+
+	IMPORT_C TInt Count() const;
+	IMPORT_C TXmlFlatElement Element(TInt aIndex) const;
+	IMPORT_C TXmlFlatElement Element(const TDesC8 & aNameSpace, const TDesC8 & aName) const;
+	IMPORT_C TInt Find(const TDesC8 & aNameSpace, const TDesC8 & aName, TInt aFrom, TInt aEnd) const;
+
+	IMPORT_C void AcceptL(MXmlFlatVisitor & aVisitor) const;
+	IMPORT_C void AcceptL(MXmlVisitor & aVisitor) const;
+	IMPORT_C TInt ApproximateTextLength() const;
+	IMPORT_C void GetAsTextL(TDes8 & aBuffer) const;
+	IMPORT_C HBufC8 * ExportToUtf8LC() const;
+
+	const TXmlFlatNode & Node(TInt aIndex) const;
+	const TXmlFlatAttribute & Attribute(TInt aIndex) const;
+	TInt AttributeCount() const;
+	TPtrC8 Text(TInt aOffset, TInt aLength) const;
+	const TDesC & WideName(const HBufC8 * aName) const;
+	const TDesC & WideText(HBufC *& aWideText, TInt aOffset, TInt aLength) const;
+
+public:
+	// From MXmlSaxHandler
+	virtual void StartElementL(const TDesC8 & aUri, const TDesC8 & aPrefix,
+			const TDesC8 & aLocalName, const Xml::RAttributeArray & aAttributes);
+	virtual void EndElementL(const TDesC8 & aUri, const TDesC8 & aPrefix,
+			const TDesC8 & aLocalName);
+	virtual void ContentL(const TDesC8 & aBytes);
+	virtual void StartPrefixMappingL(const TDesC8 & aPrefix, const TDesC8 & aUri);
+	virtual void EndPrefixMappingL(const TDesC8 & aPrefix);
+
+private:
+	CXmlFlatDocument();
+	void ConstructL();
+
+	TInt StartNodeL(const TDesC8 & aNameSpace, const TDesC8 & aName);
+	void EndNode(TInt aIndex);
+	void AddAttributeL(const TDesC8 & aNameSpace, const TDesC8 & aKey, const TDesC8 & aValue);
+	void AppendTreeL(const CXmlElement & aElement);
+	TInt AppendTextL(const TDesC8 & aText);
+	void ReserveTextL(TInt aLength);
+	void TrimValue(TXmlFlatNode & aNode);
+	void AppendStartTagL(TInt aIndex, TDes8 & aBuffer) const;
+	void AppendEndTag(TInt aIndex, TDes8 & aBuffer) const;
+	void ResetWideValues();
+
+private:
+	/** The elements, in document order. */
+	RArray<TXmlFlatNode> iNodes;
+	/** The attributes, in the order of their elements. */
+	RArray<TXmlFlatAttribute> iAttributes;
+	/** The values of the elements and attributes. */
+	RBuf8 iText;
+	/** The names of the elements and attributes, and their namespaces. */
+	CXmlStringPool * iNames;
+	/** The names queried as 16 bit, in the order of the addresses of the pooled names. */
+	mutable RArray<TXmlFlatWideName> iWideNames;
+	/** The element being built, KErrNotFound if none. */
+	TInt iCurrent;
+	/** The last child of the element being built, or the last topmost
+	 * element, KErrNotFound if none. */
+	TInt iLastChild;
+	/** Count of the namespace declarations for the next element,
+	 * at the end of iAttributes. */
+	TInt iPendingNameSpaces;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLFLATDOCUMENT_H__
@@ -0,0 +1,146 @@
+#ifndef __XMLINFLATER_H__
+#define __XMLINFLATER_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+#include <f32file.h> // RFs
+#include <ezlib.h>
+
+namespace org
+{
+namespace ajj
+{
+
+class CXmlParser;
+
+/** Default size of the window the compressed XML is inflated into. */
+const TInt KXmlDefaultInflateWindowSize = 16384;
+
+/** Compression formats of XML input understood by CXmlInflater. */
+enum TXmlCompression
+	{
+	/** Detects the format from the first bytes of the input. Input
+	 * that is not gzip, zip or zlib is passed on as plain XML. */
+	EXmlCompressionAuto,
+	/** Plain XML, passed on as is. */
+	EXmlCompressionNone,
+	/** Gzip stream (RFC 1952), e.g. a gzip encoded HTTP body. */
+	EXmlCompressionGzip,
+	/** Zlib stream (RFC 1950), e.g. a deflate encoded HTTP body. */
+	EXmlCompressionZlib,
+	/** Raw deflate data (RFC 1951) without any header. */
+	EXmlCompressionDeflate,
+	/** Zip archive, e.g. KMZ. The first .kml or .xml member is parsed. */
+	EXmlCompressionZip
+	};
+
+/**
+ * Decompresses XML incrementally in front of CXmlParser. The compressed
+ * data is given to InflateL in pieces as it arrives, and is inflated
+ * into a small window, which is fed to the parser with CXmlParser::FeedL
+ * each time it fills up. The decompressed document is thus never in memory
+ * as a whole, and decompression proceeds at the same time as parsing.<br />
+ * Usage:<br />
+ * <ul>
+ * <li>Create the parser and the inflater, giving the parser to the inflater.</li>
+ * <li>Call InflateL with each piece of compressed data, and finally FinishL,
+ * or call InflateFileL to parse a compressed file.</li>
+ * <li>Get the elements from the parser as with CXmlParser::FeedL.</li>
+ * </ul>
+ * @version $Revision: $
+ */
+class CXmlInflater : public CBase
+	{
+public:
+	IMPORT_C static CXmlInflater * NewL(CXmlParser & aParser,
+			TXmlCompression aCompression = EXmlCompressionAuto,
+			TInt aWindowSize = KXmlDefaultInflateWindowSize);
+	IMPORT_C static CXmlInflater * NewLC(CXmlParser & aParser,
+			TXmlCompression aCompression = EXmlCompressionAuto,
+			TInt aWindowSize = KXmlDefaultInflateWindowSize);
+	IMPORT_C ~CXmlInflater();
+
+	IMPORT_C void InflateL(const TDesC8 & aCompressed);
+	IMPORT_C TInt FinishL();
+	IMPORT_C TInt InflateFileL(RFs & aFs, const TDesC & aFileName);
+	IMPORT_C void Reset();
+
+private:
+	/** States of the decompression. */
+	enum TState
+		{
+		/** Gathering a header (or the bytes to detect the format). */
+		EHeader,
+		/** Inflating deflate data. */
+		EInflate,
+		/** Passing on data stored as is, counted by iRemaining. */
+		EStored,
+		/** Passing on plain XML until the end. */
+		EPassThrough,
+		/** Skipping a zip member that is not parsed, counted by iRemaining. */
+		ESkip,
+		/** The document has ended, the rest of the input is ignored. */
+		EDone
+		};
+
+	CXmlInflater(CXmlParser & aParser, TXmlCompression aCompression);
+	void ConstructL(TInt aWindowSize);
+
+	void ProcessL(const TDesC8 & aInput);
+	TInt ConsumeHeaderL(const TDesC8 & aInput);
+	TBool DetectCompression(TBool aAtEnd);
+	TInt GzipHeaderLengthL() const;
+	TInt ZipHeaderLengthL();
+	void StartInflateL(TInt aWindowBits);
+	TInt InflateChunkL(const TDesC8 & aInput);
+	void EndInflate();
+
+private:
+	/** The parser the decompressed XML is fed to. */
+	CXmlParser & iParser;
+	/** The format given by the client. */
+	const TXmlCompression iRequestedCompression;
+	/** The format of the current input, detected if iRequestedCompression is auto. */
+	TXmlCompression iCompression;
+	/** Current state of the decompression. */
+	TState iState;
+	/** The zlib stream used for inflating. */
+	z_stream iStream;
+	/** ETrue if iStream has been initialised and must be ended. */
+	TBool iStreamOpen;
+	/** The window the data is inflated into. */
+	HBufC8 * iWindow;
+	/** Header bytes gathered until the header is complete. */
+	RBuf8 iHeader;
+	/** Bytes left of a stored or skipped zip member. */
+	TUint iRemaining;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLINFLATER_H__
@@ -0,0 +1,105 @@
+#ifndef __XMLPARALLELPARSER_H__
+#define __XMLPARALLELPARSER_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+#include "XMLParser.h"
+
+namespace org
+{
+namespace ajj
+{
+
+class CXmlPiece;
+
+/** Deepest level of the document where the records are looked for. */
+const TInt KXmlMaxSplitDepth = 4;
+
+/**
+ * Parses a large document in pieces at the same time, one piece in the
+ * calling thread and the others in worker threads sharing its heap. Used by
+ * CXmlParser with the option EXmlParseParallel.<br />
+ * The document is split between the records of the element containing most
+ * of it, e.g. between the Placemarks of a KML Document, or the entries of an
+ * Atom feed. Each piece is made a document of its own by enclosing it in the
+ * start and end tags of the container and its ancestors, the first piece
+ * also containing the start of the document and the last one its end. When
+ * all pieces have been parsed, the records of the other pieces are moved
+ * under the container of the first piece, and the namespace definitions
+ * found by each piece are merged to the topmost element.
+ * @version $Revision: $
+ */
+class CXmlParallelParser : public CBase
+	{
+public:
+	static CXmlParallelParser * NewLC(TXmlTokenizer aTokenizer, TInt aPieceCount);
+	~CXmlParallelParser();
+
+	TBool SplitL(const TDesC8 & aXml);
+	TInt ParseL(RXmlElementArray & aElements);
+
+private:
+	/** Position of a start tag of an element open while splitting. */
+	class TOpenTag
+		{
+	public:
+		/** Offset of the '<' of the start tag. */
+		TInt iStart;
+		/** Offset of the byte after the '>' of the start tag. */
+		TInt iEnd;
+		/** Count of the child elements found so far. */
+		TInt iChildCount;
+		};
+
+	CXmlParallelParser(TXmlTokenizer aTokenizer, TInt aPieceCount);
+	TBool FindContainerL(const TDesC8 & aXml);
+	TBool FindCutsL(const TDesC8 & aXml);
+	void CreatePiecesL(const TDesC8 & aXml);
+	HBufC8 * CreatePieceLC(const TDesC8 & aXml, TInt aStart, TInt aEnd) const;
+	void MergeL(CXmlElement & aTarget, CXmlElement & aSource, TInt aLevel) const;
+	void MergeNameSpacesL(CXmlElement & aTarget, const CXmlElement & aSource) const;
+
+private:
+	/** The tokenizer used for the pieces. */
+	const TXmlTokenizer iTokenizer;
+	/** The count of pieces wanted. */
+	const TInt iPieceCount;
+	/** Start tags of the container and its ancestors, the topmost element first. */
+	RArray<TOpenTag> iChain;
+	/** Offset of the end tag of the container. */
+	TInt iContainerEnd;
+	/** Offsets the document is cut at, between the records of the container. */
+	RArray<TInt> iCuts;
+	/** The pieces of the document, in document order. */
+	RPointerArray<CXmlPiece> iPieces;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLPARALLELPARSER_H__
@@ -0,0 +1,88 @@
+#ifndef __XMLPARSERPOOL_H__
+#define __XMLPARSERPOOL_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+#include "XMLParser.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Default count of idle parsers kept by CXmlParserPool. */
+const TInt KXmlDefaultParserPoolSize = 4;
+
+/**
+ * Pool of reusable CXmlParser objects. Creating a parser resolves the
+ * Symbian XML parser plugin and connects to the file server, which costs
+ * far more than parsing a small document. The pool keeps released parsers
+ * and hands them out again, reset for a new document.<br />
+ * Usage:<br />
+ * <ul>
+ * <li>Create the pool once, optionally with parsers created in advance.</li>
+ * <li>Get a parser for each document with AcquireL, giving the observer.</li>
+ * <li>Parse the document and get the elements, as with a parser created with NewL.</li>
+ * <li>Give the parser back with Release. Do not delete it.</li>
+ * </ul>
+ * @version $Revision: $
+ */
+class CXmlParserPool : public CBase, private MXmlParserObserver
+	{
+public:
+	IMPORT_C static CXmlParserPool * NewL(TInt aInitialCount = 0,
+			TInt aMaxIdleCount = KXmlDefaultParserPoolSize,
+			TXmlTokenizer aTokenizer = EXmlTokenizerPlatform);
+	IMPORT_C ~CXmlParserPool();
+
+	IMPORT_C CXmlParser * AcquireL(MXmlParserObserver & aObserver);
+	IMPORT_C void Release(CXmlParser * aParser);
+	IMPORT_C TInt IdleCount() const;
+
+private:
+	// From MXmlParserObserver, idle parsers report here.
+	virtual void FragmentParsedL();
+	virtual void ParsingFinishedL(TInt aError);
+
+private:
+	CXmlParserPool(TInt aMaxIdleCount, TXmlTokenizer aTokenizer);
+	void ConstructL(TInt aInitialCount);
+
+private:
+	/** The parsers not in use. */
+	RPointerArray<CXmlParser> iIdleParsers;
+	/** The most idle parsers kept, the rest are deleted when released. */
+	TInt iMaxIdleCount;
+	/** The tokenizer of the parsers created. */
+	TXmlTokenizer iTokenizer;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLPARSERPOOL_H__
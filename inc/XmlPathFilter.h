@@ -0,0 +1,106 @@
+#ifndef __XMLPATHFILTER_H__
+#define __XMLPATHFILTER_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+namespace org
+{
+namespace ajj
+{
+
+/** Maximum count of paths in a CXmlPathFilter. */
+const TInt KXmlMaxFilterPaths = 32;
+
+/** How CXmlPathFilter matches an element starting. */
+enum TXmlPathMatch
+	{
+	/** The element is not on any path, it is skipped with its children. */
+	EXmlPathSkip,
+	/** The element is on the way to selected elements. It is kept
+	 * without its attributes and content, to hold the selected ones. */
+	EXmlPathAncestor,
+	/** The element is at the end of a path, or inside such an element.
+	 * It is kept as a whole. */
+	EXmlPathSelected
+	};
+
+/**
+ * Selects the elements CXmlParser creates, see CXmlParser::SetPathFilter.
+ * A path names the elements from the topmost element down, separated by
+ * slashes, e.g. <code>kml/Document/Placemark/name</code>. A name matches
+ * the local name of an element with any namespace prefix, unless it has
+ * a prefix itself, e.g. <code>atom:link</code>, and <code>*</code> matches
+ * any element. The elements at the end of the paths are kept as a whole,
+ * with their attributes, content and children. Their ancestors are kept
+ * without attributes and content, and all other elements are skipped.<br />
+ * The matching state of the paths is kept per depth as bit masks of
+ * the paths, so an element is compared only with the paths its parent
+ * matched, and not at all inside skipped or selected elements.
+ * @version $Revision: $
+ */
+class CXmlPathFilter : public CBase
+	{
+public:
+	IMPORT_C static CXmlPathFilter * NewL();
+	IMPORT_C static CXmlPathFilter * NewLC();
+	IMPORT_C ~CXmlPathFilter();
+
+	IMPORT_C void AddPathL(const TDesC8 & aPath);
+	IMPORT_C TInt Count() const;
+
+	// Matching, used by the parser.
+	void Reset();
+	TXmlPathMatch StartElementL(const TDesC8 & aPrefix, const TDesC8 & aLocalName);
+	TBool EndElement();
+	TBool IsSelected() const;
+
+private:
+	CXmlPathFilter();
+	TBool Matches(TInt aPath, TInt aDepth, const TDesC8 & aPrefix, const TDesC8 & aLocalName) const;
+
+private:
+	/** The names of the paths, the names of one path after each other. */
+	RPointerArray<HBufC8> iNames;
+	/** Index of the first name of each path in iNames. */
+	RArray<TInt> iFirstNames;
+	/** For each depth, the mask of the paths with a * at the depth. */
+	RArray<TUint32> iWildcardMasks;
+	/** For each depth, the mask of the paths ending at the depth. */
+	RArray<TUint32> iEndMasks;
+	/** For each element kept as an ancestor, the mask of the paths it matched. */
+	RArray<TUint32> iOpenMasks;
+	/** Count of open elements inside, and including, a selected element. */
+	TInt iSelectedDepth;
+	/** Count of open elements inside, and including, a skipped element. */
+	TInt iSkippedDepth;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLPATHFILTER_H__
@@ -0,0 +1,76 @@
+#ifndef __XMLSTRINGPOOL_H__
+#define __XMLSTRINGPOOL_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+
+namespace org
+{
+namespace ajj
+{
+
+/**
+ * Pool of interned names, shared by the elements and attributes CXmlParser
+ * creates. Each distinct name is stored once, and the elements and attributes
+ * refer to the pooled copy instead of a copy of their own, see
+ * CXmlElement::SetNameL and CKeyValue::SetKeyL. Names interned in the same
+ * pool are equal only if they are the same object, so lookups compare them
+ * by address.<br />
+ * The pool is reference counted: its creator and each element and attribute
+ * with pooled names keep it open, and it is destroyed when the last of them
+ * closes it. The count is updated atomically, so elements may be destroyed
+ * in another thread than the one interning the names, but interning and
+ * finding names must be done in one thread at a time.
+ * @version $Revision: $
+ */
+class CXmlStringPool : public CBase
+	{
+public:
+	IMPORT_C static CXmlStringPool * NewL();
+	IMPORT_C void Open();
+	IMPORT_C void Close();
+
+	IMPORT_C const HBufC8 * InternL(const TDesC8 & aString);
+	IMPORT_C const HBufC8 * Find(const TDesC8 & aString) const;
+	IMPORT_C TInt Count() const;
+
+private:
+	CXmlStringPool();
+	~CXmlStringPool();
+	TBool FindIndex(const TDesC8 & aString, TInt & aIndex) const;
+
+private:
+	/** The names, in order, owned. */
+	RPointerArray<HBufC8> iStrings;
+	/** Count of the holders of the pool. */
+	TInt iAccessCount;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLSTRINGPOOL_H__
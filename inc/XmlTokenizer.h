@@ -0,0 +1,153 @@
+#ifndef __XMLTOKENIZER_H__
+#define __XMLTOKENIZER_H__
+
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <e32base.h>
+#include <stringpool.h>
+
+#include <Xml\ContentHandler.h>
+#include <Xml\Attribute.h>
+
+namespace org
+{
+namespace ajj
+{
+
+/** A namespace declaration in scope, used by CXmlTokenizer. */
+class TXmlNamespaceMapping
+	{
+public:
+	/** The prefix declared, empty for the default namespace. */
+	RString iPrefix;
+	/** The namespace URI. */
+	RString iUri;
+	/** Depth of the element declaring the namespace. */
+	TInt iDepth;
+	};
+
+/** An attribute found in a start tag, before it is reported. */
+class TXmlRawAttribute
+	{
+public:
+	/** The qualified name of the attribute. */
+	TPtrC8 iName;
+	/** The value of the attribute, entities not decoded. */
+	TPtrC8 iValue;
+	};
+
+/**
+ * XML tokenizer reporting the XML to a Xml::MContentHandler, in the same way
+ * as the Symbian XML parser does with the features CXmlParser uses. Used by
+ * CXmlParser instead of the Symbian XML parser when created with
+ * EXmlTokenizerNative.<br />
+ * The tokenizer finds the markup by scanning the input a word at a time,
+ * and reports complete tokens straight from the input given to ParseL.
+ * Only a token split by the end of the input is copied, until the rest of
+ * it arrives. Names are reported as RStrings from the tokenizer's string pool.
+ * Content and attribute values are reported with the predefined and numeric
+ * character references decoded, CDATA sections with their markers.
+ * The content of an element can be skipped, see SkipElement.<br />
+ * <strong>NOTE</strong>: The tokenizer checks that the markup is well formed
+ * only as far as needed to find it, and that each end tag matches the start
+ * tag of the element it ends. DTDs are skipped, and entities declared in
+ * them are not replaced.
+ * @version $Revision: $
+ */
+class CXmlTokenizer : public CBase
+	{
+public:
+	IMPORT_C static CXmlTokenizer * NewL(Xml::MContentHandler & aHandler);
+	IMPORT_C ~CXmlTokenizer();
+
+	IMPORT_C void ParseBeginL();
+	IMPORT_C void ParseL(const TDesC8 & aChunk);
+	IMPORT_C void ParseEndL();
+	IMPORT_C void SkipElement();
+	IMPORT_C RStringPool & StringPool();
+
+private:
+	CXmlTokenizer(Xml::MContentHandler & aHandler);
+	void ConstructL();
+
+	TInt TokenizeL(const TDesC8 & aData, TBool aFinal);
+	TInt MarkupL(const TDesC8 & aData);
+	TInt NextMarkupL(const TDesC8 & aData);
+	TInt SkipMarkupL(const TDesC8 & aData);
+	TInt StartTagL(const TDesC8 & aData);
+	TInt DeclarationL(const TDesC8 & aData);
+	void ProcessingInstructionL(const TDesC8 & aInstruction);
+	void StartDocumentL();
+	void StartElementL(const TDesC8 & aName, TBool aIsEmpty);
+	void EndElementL(const TDesC8 & aName);
+	void ContentL(const TDesC8 & aContent);
+	void OpenTagInfoL(Xml::RTagInfo & aTagInfo, const TDesC8 & aName, TBool aIsAttribute);
+	TPtrC8 DecodeL(const TDesC8 & aRaw);
+	void AppendPendingL(const TDesC8 & aData);
+	const TDesC8 * PendingMarkupEnd(TInt & aStart) const;
+	TInt Error(TInt aError, TInt aUsed);
+	void EndMappingsL(TInt aDepth);
+	void ResetMappings();
+	static void CleanupAttributes(TAny * aTokenizer);
+
+private:
+	/** The handler the XML is reported to. */
+	Xml::MContentHandler & iHandler;
+	/** String pool for the names reported. */
+	RStringPool iStringPool;
+	/** A token split by the end of the input, waiting for the rest of it. */
+	RBuf8 iPending;
+	/** Offset in iPending from which the end of the comment, CDATA section
+	 * or processing instruction pending there is searched, see ParseL. */
+	TInt iPendingEndSearch;
+	/** The qualified names of the open elements, outermost first. */
+	RBuf8 iOpenNames;
+	/** Offsets of the names in iOpenNames, one for each open element. */
+	RArray<TInt> iOpenNameOffsets;
+	/** Content or attribute value with the references decoded. */
+	RBuf8 iDecoded;
+	/** The attributes of the start tag being reported. */
+	Xml::RAttributeArray iAttributes;
+	/** The attributes of the start tag being parsed. */
+	RArray<TXmlRawAttribute> iRawAttributes;
+	/** The namespace declarations in scope, innermost last. */
+	RArray<TXmlNamespaceMapping> iMappings;
+	/** Depth of the element being parsed, 0 outside the root element. */
+	TInt iDepth;
+	/** Depth inside the element being skipped, 0 when not skipping. */
+	TInt iSkipDepth;
+	/** ETrue when the handler has asked to skip the element starting. */
+	TBool iSkipRequested;
+	/** ETrue when OnStartDocumentL has been reported. */
+	TBool iDocumentStarted;
+	/** ETrue when an error has been reported, the rest of the document is ignored. */
+	TBool iFailed;
+	};
+
+} // ajj
+} // org
+
+#endif  // __XMLTOKENIZER_H__
@@ -36,6 +36,7 @@ namespace ajj
 class CXmlDocument;
 class CXmlElement;
 class CKeyValue;
+class TXmlFlatElement;
 
 /**
  * Defines an interface for a visitor, visiting XML structures.
@@ -66,6 +67,22 @@ public:
 	virtual TBool VisitorNavigates() const = 0;
 };
 
+/**
+ * Defines an interface for a visitor of CXmlFlatDocument. The document
+ * navigates, visiting its elements in document order.
+ * @version $Revision: $
+ */
+class MXmlFlatVisitor
+{
+public:
+	virtual ~MXmlFlatVisitor() {};
+
+	/** Pure virtual visit method, implemented in subclasses.
+	 * @param aElement Element to visit.
+	 */
+	virtual void VisitL(const TXmlFlatElement & aElement) = 0;
+};
+
 } // ajj
 } // org
 
@@ -23,8 +23,6 @@
  * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
  */
 
-#include <utf.h>
-
 #include "ConversionUtils.h"
 #include "XMLParserConstants.h"
 
@@ -33,9 +31,204 @@ namespace org
 namespace ajj
 {
 
+/** Longest character reference decoded, e.g. &#x10FFFF; */
+const TInt KMaxReferenceLength = 12;
+/** Largest Unicode code point. */
+const TUint KMaxCodePoint = 0x10FFFF;
+/** Character that replaces invalid UTF-8. */
+const TUint16 KReplacementCharacter = 0xfffd;
+
+_LIT8(KEntityLt, "lt");
+_LIT8(KEntityGt, "gt");
+_LIT8(KEntityAmp, "amp");
+_LIT8(KEntityQuot, "quot");
+_LIT8(KEntityApos, "apos");
+_LIT(KConversionUtilsPanic, "ConversionUtils");
+
+/**
+ * Counts the ASCII bytes at the start of UTF-8 text. The bytes are
+ * checked 16 at a time, the top bits of four words at once.
+ * @param aPtr Start of the text.
+ * @param aEnd End of the text.
+ * @returns The count of ASCII bytes.
+ */
+LOCAL_C TInt AsciiLength(const TUint8 * aPtr, const TUint8 * aEnd)
+	{
+	const TUint8 * ptr = aPtr;
+	while (ptr < aEnd && (reinterpret_cast<TLinAddr>(ptr) & 3))
+		{
+		if (*ptr >= 0x80)
+			{
+			return ptr - aPtr;
+			}
+		++ptr;
+		}
+	const TUint32 highBits = 0x80808080u;
+	const TUint32 * word = reinterpret_cast<const TUint32 *>(ptr);
+	while (aEnd - reinterpret_cast<const TUint8 *>(word) >= 16
+			&& !((word[0] | word[1] | word[2] | word[3]) & highBits))
+		{
+		word += 4;
+		}
+	while (aEnd - reinterpret_cast<const TUint8 *>(word) >= 4 && !(*word & highBits))
+		{
+		++word;
+		}
+	ptr = reinterpret_cast<const TUint8 *>(word);
+	while (ptr < aEnd && *ptr < 0x80)
+		{
+		++ptr;
+		}
+	return ptr - aPtr;
+	}
+
+/**
+ * Counts the ASCII characters at the start of 16 bit text. The characters
+ * are checked 16 at a time, the top nine bits of each in eight words at once.
+ * @param aPtr Start of the text.
+ * @param aEnd End of the text.
+ * @returns The count of ASCII characters.
+ */
+LOCAL_C TInt AsciiLength(const TUint16 * aPtr, const TUint16 * aEnd)
+	{
+	const TUint16 * ptr = aPtr;
+	if (ptr < aEnd && (reinterpret_cast<TLinAddr>(ptr) & 3))
+		{
+		if (*ptr >= 0x80)
+			{
+			return 0;
+			}
+		++ptr;
+		}
+	const TUint32 highBits = 0xff80ff80u;
+	const TUint32 * word = reinterpret_cast<const TUint32 *>(ptr);
+	while (aEnd - reinterpret_cast<const TUint16 *>(word) >= 16
+			&& !((word[0] | word[1] | word[2] | word[3] | word[4] | word[5] | word[6] | word[7]) & highBits))
+		{
+		word += 8;
+		}
+	while (aEnd - reinterpret_cast<const TUint16 *>(word) >= 2 && !(*word & highBits))
+		{
+		++word;
+		}
+	ptr = reinterpret_cast<const TUint16 *>(word);
+	while (ptr < aEnd && *ptr < 0x80)
+		{
+		++ptr;
+		}
+	return ptr - aPtr;
+	}
+
+/**
+ * Reads a character of 16 bit text, combining a surrogate pair.
+ * An unpaired surrogate is read as the replacement character.
+ * @param aPtr The character to read, moved past it.
+ * @param aEnd End of the text.
+ * @returns The Unicode code point.
+ */
+LOCAL_C TUint ReadUtf16(const TUint16 * & aPtr, const TUint16 * aEnd)
+	{
+	TUint code = *aPtr++;
+	if (code >= 0xd800 && code < 0xdc00 && aPtr < aEnd && *aPtr >= 0xdc00 && *aPtr < 0xe000)
+		{
+		code = 0x10000 + ((code - 0xd800) << 10) + (*aPtr++ - 0xdc00);
+		}
+	else if (code >= 0xd800 && code < 0xe000)
+		{
+		code = KReplacementCharacter;
+		}
+	return code;
+	}
+
+/**
+ * Writes a Unicode code point as UTF-16, as a surrogate pair if needed.
+ * @param aTarget Where to write.
+ * @param aCode The code point.
+ * @returns The end of the characters written.
+ */
+LOCAL_C TUint16 * WriteUtf16(TUint16 * aTarget, TUint aCode)
+	{
+	if (aCode >= 0x10000)
+		{
+		aCode -= 0x10000;
+		*aTarget++ = static_cast<TUint16>(0xd800 | (aCode >> 10));
+		*aTarget++ = static_cast<TUint16>(0xdc00 | (aCode & 0x3ff));
+		}
+	else
+		{
+		*aTarget++ = static_cast<TUint16>(aCode);
+		}
+	return aTarget;
+	}
+
+/**
+ * Converts UTF-8 to UTF-16, writing it to memory with room for it. ASCII
+ * is widened a block at a time, see AsciiLength, and the rest decoded and
+ * validated a character at a time. Invalid UTF-8 is converted to the
+ * replacement character, a byte at a time.
+ * @param aPtr Start of the UTF-8.
+ * @param aEnd End of the UTF-8.
+ * @param aTarget Where to write, room for as many characters as there are bytes.
+ * @returns The end of the characters written.
+ */
+LOCAL_C TUint16 * WidenUtf8(const TUint8 * aPtr, const TUint8 * aEnd, TUint16 * aTarget)
+	{
+	while (aPtr < aEnd)
+		{
+		const TInt ascii = AsciiLength(aPtr, aEnd);
+		for (TInt counter = 0; counter < ascii; ++counter)
+			{
+			aTarget[counter] = aPtr[counter];
+			}
+		aTarget += ascii;
+		aPtr += ascii;
+		if (aPtr == aEnd)
+			{
+			break;
+			}
+		TUint code = *aPtr;
+		TInt length = 0;
+		TUint min = 0;
+		if ((code & 0xe0) == 0xc0)
+			{
+			length = 2;
+			min = 0x80;
+			code &= 0x1f;
+			}
+		else if ((code & 0xf0) == 0xe0)
+			{
+			length = 3;
+			min = 0x800;
+			code &= 0x0f;
+			}
+		else if ((code & 0xf8) == 0xf0)
+			{
+			length = 4;
+			min = 0x10000;
+			code &= 0x07;
+			}
+		TInt pos = 1;
+		for (; pos < length && aPtr + pos < aEnd && (aPtr[pos] & 0xc0) == 0x80; ++pos)
+			{
+			code = (code << 6) | (aPtr[pos] & 0x3f);
+			}
+		if (length == 0 || pos < length || code < min || code > KMaxCodePoint
+				|| (code >= 0xd800 && code < 0xe000))
+			{
+			*aTarget++ = KReplacementCharacter;
+			++aPtr;
+			continue;
+			}
+		aPtr += length;
+		aTarget = WriteUtf16(aTarget, code);
+		}
+	return aTarget;
+	}
 
 /** Converts an Unicode string to a UTF-8 string, appending the
- * generated UTF-8 string to an existing 8 bit descriptor.
+ * generated UTF-8 string to an existing 8 bit descriptor. Runs of
+ * ASCII are found 16 characters at a time and appended narrowed in bulk,
+ * the rest is encoded a character at a time. Nothing is allocated.
  * There must be enough room in the descriptor to add, otherwise a
  * panic will occur.
  * @param aThingToAdd The 16 bit descriptor to convert.
@@ -43,129 +236,498 @@ namespace ajj
  */
 void ConversionUtils::AppendToUtf8BufferL(const TDesC & aThingToAdd, TDes8 & aWhereToAdd)
 	{
-	HBufC8 * converted = 0;
-	converted = CnvUtfConverter::ConvertFromUnicodeToUtf8L(aThingToAdd);
-	if (converted != 0)
-		{
-		aWhereToAdd.Append(*converted);
-		}
-	delete converted;
-	
-//	TInt currLen = aWhereToAdd.Length();
-//	TInt toAddLen = aThingToAdd.Length();
-//	TInt totalLen = currLen+toAddLen;
-//	aWhereToAdd.SetLength(currLen+toAddLen);
-//	TPtr8 ptr(aWhereToAdd.MidTPtr(currLen));
-//	TInt result = CnvUtfConverter::ConvertFromUnicodeToUtf8(ptr, aThingToAdd);
-//	while (result > 0)
-//		{
-//		currLen = aWhereToAdd.Length();
-//		aWhereToAdd.SetLength(currLen+result+1);
-//		TPtr8 ptr(aWhereToAdd.MidTPtr(currLen));
-////		ptr.FillZ();
-//		result = CnvUtfConverter::ConvertFromUnicodeToUtf8(ptr, aThingToAdd.Right(result));
-//		}
-//	aWhereToAdd.SetLength(currLen+toAddLen);
-	}
-
-/**
- * Appends a 16 bit descriptor to a 8 bit one, encoding chars not allowed
- * in XML content. There must be enough room in the receiving descriptor,
- * otherwise a panic will occur.
- * @param aThingToAdd The text to add.
- * @param aWhereToAdd The buffer to add the text to. 
+	const TUint16 * ptr = aThingToAdd.Ptr();
+	const TUint16 * const end = ptr + aThingToAdd.Length();
+	while (ptr < end)
+		{
+		const TInt ascii = AsciiLength(ptr, end);
+		aWhereToAdd.Append(TPtrC16(ptr, ascii));
+		ptr += ascii;
+		if (ptr < end)
+			{
+			AppendUtf8(aWhereToAdd, ReadUtf16(ptr, end));
+			}
+		}
+	}
+
+/**
+ * Converts an Unicode string to UTF-8 in a buffer of its exact length.
+ * @param aText The 16 bit text to convert.
+ * @returns The UTF-8, owned by the caller.
  */
-void ConversionUtils::AppendToUtf8BufferEncodedL(const TDesC & aThingToAdd, TDes8 & aWhereToAdd)
+HBufC8 * ConversionUtils::ConvertToUtf8L(const TDesC & aText)
 	{
-	const TInt bufLen = aThingToAdd.Length();
-	HBufC * encoded = HBufC::NewL(bufLen*2);
-	TPtr ptr(encoded->Des());
-	for (TInt counter = 0; counter < bufLen; ++counter)
+	const TUint16 * ptr = aText.Ptr();
+	const TUint16 * const end = ptr + aText.Length();
+	TInt length = 0;
+	while (ptr < end)
 		{
-		if (aThingToAdd[counter] == KCharLessThan()[0])
+		const TInt ascii = AsciiLength(ptr, end);
+		length += ascii;
+		ptr += ascii;
+		if (ptr < end)
 			{
-			ptr.Append(KLTReference);
+			const TUint code = ReadUtf16(ptr, end);
+			length += (code < 0x800) ? 2 : (code < 0x10000) ? 3 : 4;
 			}
-		else if (aThingToAdd[counter] == KCharGreaterThan()[0])
+		}
+	HBufC8 * buffer = HBufC8::NewL(length);
+	TPtr8 converted(buffer->Des());
+	AppendToUtf8BufferL(aText, converted);
+	return buffer;
+	}
+
+/**
+ * Converts UTF-8 to an Unicode string, in a buffer long enough for it.
+ * @param aText The UTF-8 text to convert.
+ * @returns The 16 bit text, owned by the caller.
+ */
+HBufC * ConversionUtils::ConvertToUnicodeL(const TDesC8 & aText)
+	{
+	HBufC * buffer = HBufC::NewL(aText.Length());
+	TPtr converted(buffer->Des());
+	AppendToUnicodeBufferL(aText, converted);
+	return buffer;
+	}
+
+/** Query if a character is encoded by the AppendToUtf8BufferEncodedL methods. */
+LOCAL_C TBool IsEscaped(TUint aChar)
+	{
+	return aChar == '<' || aChar == '>' || aChar == '&' || aChar == '%';
+	}
+
+/**
+ * Appends the reference of a character encoded on export.
+ * @param aChar A character for which IsEscaped is true.
+ * @param aWhereToAdd The buffer to add the reference to.
+ */
+LOCAL_C void AppendEscaped(TUint aChar, TDes8 & aWhereToAdd)
+	{
+	switch (aChar)
+		{
+		case '<':
+			aWhereToAdd.Append(KLTReference8);
+			break;
+		case '>':
+			aWhereToAdd.Append(KGTReference8);
+			break;
+		case '&':
+			aWhereToAdd.Append(KAmpersandReference8);
+			break;
+		default:
+			aWhereToAdd.Append(KPercentReference8);
+			break;
+		}
+	}
+
+/**
+ * Query if a word has a zero in one of its lanes, see FindByte.
+ * @param aWord The word.
+ * @param aOnes The word with each lane 1.
+ * @param aHighBits The word with the top bit of each lane set.
+ */
+LOCAL_C TBool HasZeroLane(TUint32 aWord, TUint32 aOnes, TUint32 aHighBits)
+	{
+	return ((aWord - aOnes) & ~aWord & aHighBits) != 0;
+	}
+
+/**
+ * Counts the bytes at the start of UTF-8 text that are appended as they
+ * are on export. Four bytes are checked at a time, see FindByte.
+ * @param aPtr Start of the text.
+ * @param aEnd End of the text.
+ * @returns The count of bytes not to encode.
+ */
+LOCAL_C TInt PlainLength(const TUint8 * aPtr, const TUint8 * aEnd)
+	{
+	const TUint8 * ptr = aPtr;
+	while (ptr < aEnd && (reinterpret_cast<TLinAddr>(ptr) & 3))
+		{
+		if (IsEscaped(*ptr))
 			{
-			ptr.Append(KGTReference);
+			return ptr - aPtr;
 			}
-		else if (aThingToAdd[counter] == KCharAmpersand()[0])
+		++ptr;
+		}
+	const TUint32 ones = 0x01010101u;
+	const TUint32 highBits = 0x80808080u;
+	while (aEnd - ptr >= 4)
+		{
+		const TUint32 word = *reinterpret_cast<const TUint32 *>(ptr);
+		if (HasZeroLane(word ^ ('<' * ones), ones, highBits)
+				|| HasZeroLane(word ^ ('>' * ones), ones, highBits)
+				|| HasZeroLane(word ^ ('&' * ones), ones, highBits)
+				|| HasZeroLane(word ^ ('%' * ones), ones, highBits))
 			{
-			ptr.Append(KAmpersandReference);
+			break;
 			}
-		else if (aThingToAdd[counter] == KCharPercent()[0])
+		ptr += 4;
+		}
+	while (ptr < aEnd && !IsEscaped(*ptr))
+		{
+		++ptr;
+		}
+	return ptr - aPtr;
+	}
+
+/**
+ * Counts the characters at the start of 16 bit text that are ASCII and
+ * appended as they are on export. Two characters are checked at a time,
+ * see FindByte.
+ * @param aPtr Start of the text.
+ * @param aEnd End of the text.
+ * @returns The count of characters to append narrowed.
+ */
+LOCAL_C TInt PlainLength(const TUint16 * aPtr, const TUint16 * aEnd)
+	{
+	const TUint16 * ptr = aPtr;
+	if (ptr < aEnd && (reinterpret_cast<TLinAddr>(ptr) & 3))
+		{
+		if (*ptr >= 0x80 || IsEscaped(*ptr))
+			{
+			return 0;
+			}
+		++ptr;
+		}
+	const TUint32 ones = 0x00010001u;
+	const TUint32 highBits = 0x80008000u;
+	while (aEnd - ptr >= 2)
+		{
+		const TUint32 word = *reinterpret_cast<const TUint32 *>(ptr);
+		if ((word & 0xff80ff80u)
+				|| HasZeroLane(word ^ ('<' * ones), ones, highBits)
+				|| HasZeroLane(word ^ ('>' * ones), ones, highBits)
+				|| HasZeroLane(word ^ ('&' * ones), ones, highBits)
+				|| HasZeroLane(word ^ ('%' * ones), ones, highBits))
 			{
-			ptr.Append(KPercentReference);
 			break;
 			}
-		else
+		ptr += 2;
+		}
+	while (ptr < aEnd && *ptr < 0x80 && !IsEscaped(*ptr))
+		{
+		++ptr;
+		}
+	return ptr - aPtr;
+	}
+
+/**
+ * Appends a 16 bit descriptor to a 8 bit one as UTF-8, encoding chars not
+ * allowed in XML content. Escaping and conversion are done in one pass
+ * straight into the receiving descriptor: runs of ASCII needing no encoding
+ * are found a few characters at a time and appended narrowed, the rest
+ * are encoded a character at a time. There must be enough room in the
+ * receiving descriptor, otherwise a panic will occur.
+ * @param aThingToAdd The text to add.
+ * @param aWhereToAdd The buffer to add the text to. 
+ */
+void ConversionUtils::AppendToUtf8BufferEncodedL(const TDesC & aThingToAdd, TDes8 & aWhereToAdd)
+	{
+	const TUint16 * ptr = aThingToAdd.Ptr();
+	const TUint16 * const end = ptr + aThingToAdd.Length();
+	while (ptr < end)
+		{
+		const TInt plain = PlainLength(ptr, end);
+		if (plain > 0)
+			{
+			aWhereToAdd.Append(TPtrC16(ptr, plain));
+			ptr += plain;
+			continue;
+			}
+		if (IsEscaped(*ptr))
+			{
+			AppendEscaped(*ptr++, aWhereToAdd);
+			continue;
+			}
+		AppendUtf8(aWhereToAdd, ReadUtf16(ptr, end));
+		}
+	}
+
+/**
+ * Appends UTF-8 to another UTF-8 descriptor, encoding chars not allowed
+ * in XML content, as the 16 bit version does. The runs needing no encoding
+ * are appended in bulk. There must be enough room in the receiving
+ * descriptor, otherwise a panic will occur.
+ * @param aThingToAdd The UTF-8 text to add.
+ * @param aWhereToAdd The buffer to add the text to.
+ */
+void ConversionUtils::AppendToUtf8BufferEncodedL(const TDesC8 & aThingToAdd, TDes8 & aWhereToAdd)
+	{
+	const TUint8 * ptr = aThingToAdd.Ptr();
+	const TUint8 * const end = ptr + aThingToAdd.Length();
+	while (ptr < end)
+		{
+		const TInt plain = PlainLength(ptr, end);
+		aWhereToAdd.Append(ptr, plain);
+		ptr += plain;
+		if (ptr < end)
 			{
-			ptr.Append(aThingToAdd[counter]);
-			} // End if
+			AppendEscaped(*ptr++, aWhereToAdd);
+			}
 		}
-	ConversionUtils::AppendToUtf8BufferL(*encoded, aWhereToAdd);
-	delete encoded;
 	}
 
 /** Converts an 8 bit UTF-8 string to an unicode string, appending the
- * generated unicode string to an existing 16 bit descriptor.
- * There must be enough room in the descriptor to add, otherwise a
- * panic will occur.
+ * generated unicode string to an existing 16 bit descriptor. The UTF-8
+ * is converted and validated straight into the descriptor, ASCII widened
+ * 16 bytes at a time, without allocating. Invalid UTF-8 is converted to
+ * the replacement character.
+ * There must be room in the descriptor for as many characters as there
+ * are bytes to add, otherwise a panic will occur.
  * @param aThingToAdd The 8 bit descriptor to convert.
  * @param aWhereToAdd The 16 bit descriptor to add the Unicode converted string.
  */
 void ConversionUtils::AppendToUnicodeBufferL(const TDesC8 & aThingToAdd, TDes & aWhereToAdd)
 	{
-	HBufC * converted = 0;
-	converted = CnvUtfConverter::ConvertToUnicodeFromUtf8L(aThingToAdd);
-	if (converted != 0)
-		{
-		aWhereToAdd.Append(*converted);
-		}
-	delete converted;
-//	TInt currLen = aWhereToAdd.Length();
-//	aWhereToAdd.SetLength(currLen+aThingToAdd.Length());
-//	TPtr ptr(aWhereToAdd.MidTPtr(currLen));
-//	CnvUtfConverter::ConvertToUnicodeFromUtf8(ptr, aThingToAdd);
+	__ASSERT_ALWAYS(aWhereToAdd.MaxLength() - aWhereToAdd.Length() >= aThingToAdd.Length(),
+			User::Panic(KConversionUtilsPanic, KErrOverflow));
+	TUint16 * const start = const_cast<TUint16 *>(aWhereToAdd.Ptr());
+	TUint16 * const end = WidenUtf8(aThingToAdd.Ptr(), aThingToAdd.Ptr() + aThingToAdd.Length(),
+			start + aWhereToAdd.Length());
+	aWhereToAdd.SetLength(end - start);
 	}
 
 /** Converts an 8 bit UTF-8 string to an unicode string, appending and
  * decoding the  generated unicode string to an existing 16 bit descriptor.
- * There must be enough room in the descriptor to add, otherwise a
- * panic will occur.
+ * The text is converted in one pass straight into the descriptor: the runs
+ * between references are found a word at a time and converted as they are,
+ * and each reference is decoded where it is. Decodes the predefined
+ * entities and the numeric character references.
+ * There must be room in the descriptor for as many characters as there
+ * are bytes to add, otherwise a panic will occur.
  * @param aThingToAdd The 8 bit descriptor to convert.
  * @param aWhereToAdd The 16 bit descriptor to add the Unicode converted string.
  */
 void ConversionUtils::AppendToUnicodeBufferDecodedL(const TDesC8 & aThingToAdd, TDes & aWhereToAdd)
 	{
-	const TInt bufLen = aThingToAdd.Length();
-	HBufC8 * decoded = HBufC8::NewL(bufLen*2);
-	TPtr8 ptr(decoded->Des());
-	ptr.Copy(aThingToAdd);
-	
-	const TBufC8<10> replaceables[] = { KLTReference8(), KGTReference8(), KAmpersandReference8(), KPercentReference8() };
-	const TBufC8<10> replaceWiths[] = { KCharLessThan8(), KCharGreaterThan8(), KCharAmpersand8(), KCharPercent8() };
-	const TInt KReplaceableCount = 4;
-	TInt index = 0;
-	for (TInt counter = 0; counter < KReplaceableCount; counter++)
-		{
-		const TDesC8 & toReplace = replaceables[counter];
-		const TDesC8 & replaceWith = replaceWiths[counter];
-		do
-			{
-			index = ptr.Find(toReplace);
-			if (index >= KErrNone)
+	// A character never takes more 16 bit units than it has UTF-8 bytes,
+	// nor a reference more than its own length.
+	__ASSERT_ALWAYS(aWhereToAdd.MaxLength() - aWhereToAdd.Length() >= aThingToAdd.Length(),
+			User::Panic(KConversionUtilsPanic, KErrOverflow));
+	TUint16 * const start = const_cast<TUint16 *>(aWhereToAdd.Ptr());
+	TUint16 * target = start + aWhereToAdd.Length();
+	TPtrC8 rest(aThingToAdd);
+	TInt ampersand = FindByte(rest, KCharAmpersand8()[0]);
+	while (ampersand != KErrNotFound)
+		{
+		target = WidenUtf8(rest.Ptr(), rest.Ptr() + ampersand, target);
+		rest.Set(rest.Mid(ampersand));
+		TUint code = 0;
+		TInt used = DecodeReference(rest, code);
+		if (used == 0)
+			{
+			// Not a reference, the ampersand is kept.
+			code = KCharAmpersand8()[0];
+			used = 1;
+			}
+		target = WriteUtf16(target, code);
+		rest.Set(rest.Mid(used));
+		ampersand = FindByte(rest, KCharAmpersand8()[0]);
+		}
+	target = WidenUtf8(rest.Ptr(), rest.Ptr() + rest.Length(), target);
+	aWhereToAdd.SetLength(target - start);
+	}
+
+/**
+ * Decodes the references of the chars encoded on export, in place, and
+ * the other predefined entities and numeric character references. The
+ * text is decoded in one pass, the runs between references moved in bulk.
+ * The decoded text is never longer than the original.
+ * @param aText The 8 bit text to decode.
+ */
+void ConversionUtils::DecodeReferences(TDes8 & aText)
+	{
+	TInt ampersand = FindByte(aText, KCharAmpersand8()[0]);
+	if (ampersand == KErrNotFound)
+		{
+		return;
+		}
+	// The decoded text is written over the original, behind the part still to be read.
+	TPtr8 decoded(const_cast<TUint8 *>(aText.Ptr()), ampersand, aText.Length());
+	TPtrC8 rest(aText.Mid(ampersand));
+	FOREVER
+		{
+		rest.Set(rest.Mid(AppendReference(rest, decoded)));
+		ampersand = FindByte(rest, KCharAmpersand8()[0]);
+		if (ampersand == KErrNotFound)
+			{
+			decoded.Append(rest);
+			break;
+			}
+		decoded.Append(rest.Left(ampersand));
+		rest.Set(rest.Mid(ampersand));
+		}
+	aText.SetLength(decoded.Length());
+	}
+
+/**
+ * Decodes a reference at the start of the data: a predefined entity,
+ * or a decimal or hexadecimal character reference.
+ * @param aReference Data starting with '&'.
+ * @param aCode The decoded Unicode code point.
+ * @returns The length of the reference, 0 if the data does not start with one.
+ */
+TInt ConversionUtils::DecodeReference(const TDesC8 & aReference, TUint & aCode)
+	{
+	const TInt end = aReference.Left(KMaxReferenceLength).Locate(';');
+	if (end < 2)
+		{
+		return 0;
+		}
+	TPtrC8 name(aReference.Mid(1, end - 1));
+	TUint code = 0;
+	if (name[0] == '#')
+		{
+		const TBool isHex = name.Length() > 1 && (name[1] == 'x' || name[1] == 'X');
+		TInt pos = isHex ? 2 : 1;
+		if (pos >= name.Length())
+			{
+			return 0;
+			}
+		for (; pos < name.Length() && code <= KMaxCodePoint; ++pos)
+			{
+			const TUint digit = name[pos];
+			if (digit >= '0' && digit <= '9')
+				{
+				code = code * (isHex ? 16 : 10) + digit - '0';
+				}
+			else if (isHex && (digit | 0x20) >= 'a' && (digit | 0x20) <= 'f')
 				{
-				ptr.Replace(index, toReplace.Length(), replaceWith);
+				code = code * 16 + (digit | 0x20) - 'a' + 10;
 				}
-			} while (index >= KErrNone);
+			else
+				{
+				break;
+				}
+			}
+		if (pos < name.Length() || code == 0 || code > KMaxCodePoint
+				|| (code >= 0xd800 && code < 0xe000))
+			{
+			return 0;
+			}
+		}
+	else if (name == KEntityLt)
+		{
+		code = '<';
+		}
+	else if (name == KEntityGt)
+		{
+		code = '>';
+		}
+	else if (name == KEntityAmp)
+		{
+		code = '&';
+		}
+	else if (name == KEntityQuot)
+		{
+		code = '"';
+		}
+	else if (name == KEntityApos)
+		{
+		code = '\'';
+		}
+	else
+		{
+		return 0;
+		}
+	aCode = code;
+	return end + 1;
+	}
+
+/**
+ * Decodes a reference at the start of the data, appending the character
+ * as UTF-8. Unknown references are left as they are. The decoded character
+ * is never longer than the reference.
+ * @param aReference Data starting with '&'.
+ * @param aTarget Where to append the character.
+ * @returns The count of bytes used from aReference.
+ */
+TInt ConversionUtils::AppendReference(const TDesC8 & aReference, TDes8 & aTarget)
+	{
+	TUint code = 0;
+	const TInt used = DecodeReference(aReference, code);
+	if (used == 0)
+		{
+		aTarget.Append(KCharAmpersand8);
+		return 1;
 		}
+	AppendUtf8(aTarget, code);
+	return used;
+	}
 
-	ConversionUtils::AppendToUnicodeBufferL(*decoded, aWhereToAdd);
-	delete decoded;
+/**
+ * Appends a Unicode code point to a descriptor, encoded in UTF-8.
+ * @param aTarget Where to append.
+ * @param aCode The code point.
+ */
+void ConversionUtils::AppendUtf8(TDes8 & aTarget, TUint aCode)
+	{
+	if (aCode < 0x80)
+		{
+		aTarget.Append(aCode);
+		}
+	else if (aCode < 0x800)
+		{
+		aTarget.Append(0xc0 | (aCode >> 6));
+		aTarget.Append(0x80 | (aCode & 0x3f));
+		}
+	else if (aCode < 0x10000)
+		{
+		aTarget.Append(0xe0 | (aCode >> 12));
+		aTarget.Append(0x80 | ((aCode >> 6) & 0x3f));
+		aTarget.Append(0x80 | (aCode & 0x3f));
+		}
+	else
+		{
+		aTarget.Append(0xf0 | (aCode >> 18));
+		aTarget.Append(0x80 | ((aCode >> 12) & 0x3f));
+		aTarget.Append(0x80 | ((aCode >> 6) & 0x3f));
+		aTarget.Append(0x80 | (aCode & 0x3f));
+		}
 	}
 
+/**
+ * Finds a byte in a descriptor. The bytes are compared a word at a time:
+ * a word XORed with the byte repeated has a zero byte where the byte is,
+ * and subtracting 1 from each byte of the word borrows into the top bit
+ * of such a byte.
+ * @param aData The data to search.
+ * @param aByte The byte to find.
+ * @returns The offset of the byte, KErrNotFound if not found.
+ */
+TInt ConversionUtils::FindByte(const TDesC8 & aData, TUint8 aByte)
+	{
+	const TUint8 * start = aData.Ptr();
+	const TUint8 * ptr = start;
+	const TUint8 * end = start + aData.Length();
+	while (ptr < end && (reinterpret_cast<TLinAddr>(ptr) & 3))
+		{
+		if (*ptr == aByte)
+			{
+			return ptr - start;
+			}
+		++ptr;
+		}
+	const TUint32 pattern = aByte * 0x01010101u;
+	while (end - ptr >= 4)
+		{
+		const TUint32 word = *reinterpret_cast<const TUint32 *>(ptr) ^ pattern;
+		if ((word - 0x01010101u) & ~word & 0x80808080u)
+			{
+			break;
+			}
+		ptr += 4;
+		}
+	while (ptr < end)
+		{
+		if (*ptr == aByte)
+			{
+			return ptr - start;
+			}
+		++ptr;
+		}
+	return KErrNotFound;
+	}
 
 } // ajj
 } // org
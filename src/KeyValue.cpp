@@ -23,30 +23,35 @@
  * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
  */
 
-#include <utf.h>
-
-
 #include "KeyValue.h"
 #include "XMLParserConstants.h"
 #include "ConversionUtils.h"
 #include "XmlVisitor.h"
+#include "XmlStringPool.h"
+#include "XmlArena.h"
 
 namespace org
 {
 namespace ajj
 {
 
-/** Default constructor for the class. */
+/** Default constructor for the class, remembers the heap the object is created in. */
 EXPORT_C CKeyValue::CKeyValue()
+: iHeap(&User::Allocator())
 	{
 	}
 
 /** Destructor for the class. */
 EXPORT_C CKeyValue::~CKeyValue()
 	{
-	delete iNameSpace;
-	delete iKey;
+	ResetNameSpace();
+	ResetKey();
 	delete iValue;
+	delete iValue8;
+	if (iPool)
+		{
+		iPool->Close();
+		}
 	}
 
 
@@ -213,11 +218,25 @@ void CKeyValue::ConstructL(const TDesC8 & aNameSpace, const TDesC8 & aKey, const
 	SetValueL(aValue);
 	}
 
-/** Query the namespace of the object.
+/** Query the namespace of the object. A namespace set as 8 bit is widened
+ * on the first query. If there is no memory for it, the namespace is
+ * empty until a later query succeeds.
  * @returns The namespace value.
  */
 EXPORT_C const TDesC & CKeyValue::NameSpace() const
 	{
+	if (!iNameSpace && iNameSpace8)
+		{
+		// Allocated in the heap of the object, see CXmlArena.
+		RAllocator * previous = CXmlArena::SwitchHeap(*iHeap);
+		iNameSpace = HBufC::New(iNameSpace8->Length());
+		CXmlArena::SwitchHeapBack(previous);
+		if (!iNameSpace)
+			{
+			return KNullDesC;
+			}
+		iNameSpace->Des().Copy(*iNameSpace8);
+		}
 	if (iNameSpace)
 		{
 		return *iNameSpace;
@@ -225,11 +244,49 @@ EXPORT_C const TDesC & CKeyValue::NameSpace() const
 	return KNullDesC;
 	}
 
-/** Query the key of the object.
+/** Query the namespace of the object, 8 bit version. A namespace set as
+ * 16 bit is narrowed on the first query. If there is no memory for it,
+ * the namespace is empty until a later query succeeds.
+ * @returns The namespace value.
+ */
+EXPORT_C const TDesC8 & CKeyValue::NameSpace8() const
+	{
+	if (!iNameSpace8 && iNameSpace)
+		{
+		RAllocator * previous = CXmlArena::SwitchHeap(*iHeap);
+		iNameSpace8 = HBufC8::New(iNameSpace->Length());
+		CXmlArena::SwitchHeapBack(previous);
+		if (!iNameSpace8)
+			{
+			return KNullDesC8;
+			}
+		iNameSpace8->Des().Copy(*iNameSpace);
+		}
+	if (iNameSpace8)
+		{
+		return *iNameSpace8;
+		}
+	return KNullDesC8;
+	}
+
+/** Query the key of the object. A key set as 8 bit is widened on the
+ * first query. If there is no memory for it, the key is empty until
+ * a later query succeeds.
  * @returns The key's value.
  */
 EXPORT_C const TDesC & CKeyValue::Key() const
 	{
+	if (!iKey && iKey8)
+		{
+		RAllocator * previous = CXmlArena::SwitchHeap(*iHeap);
+		iKey = HBufC::New(iKey8->Length());
+		CXmlArena::SwitchHeapBack(previous);
+		if (!iKey)
+			{
+			return KNullDesC;
+			}
+		iKey->Des().Copy(*iKey8);
+		}
 	if (iKey)
 		{
 		return *iKey;
@@ -237,11 +294,46 @@ EXPORT_C const TDesC & CKeyValue::Key() const
 	return KNullDesC;
 	}
 
-/** Query the key of the object.
- * @returns The key's value, KNullDesC if no value.
+/** Query the key of the object, 8 bit version. A key set as 16 bit is
+ * narrowed on the first query. If there is no memory for it, the key
+ * is empty until a later query succeeds.
+ * @returns The key's value.
+ */
+EXPORT_C const TDesC8 & CKeyValue::Key8() const
+	{
+	if (!iKey8 && iKey)
+		{
+		RAllocator * previous = CXmlArena::SwitchHeap(*iHeap);
+		iKey8 = HBufC8::New(iKey->Length());
+		CXmlArena::SwitchHeapBack(previous);
+		if (!iKey8)
+			{
+			return KNullDesC8;
+			}
+		iKey8->Des().Copy(*iKey);
+		}
+	if (iKey8)
+		{
+		return *iKey8;
+		}
+	return KNullDesC8;
+	}
+
+/** Query the value of the object. A value set as UTF-8 is converted
+ * on the first query. If there is no memory for converting it,
+ * the value is empty until a later query succeeds.
+ * @returns The value, KNullDesC if no value.
  */
 EXPORT_C const TDesC & CKeyValue::Value() const
 	{
+	if (!iValue && iValue8)
+		{
+		TRAPD(error, PrepareValueL());
+		if (error != KErrNone)
+			{
+			return KNullDesC;
+			}
+		}
 	if (iValue)
 		{
 		return *iValue;
@@ -249,6 +341,82 @@ EXPORT_C const TDesC & CKeyValue::Value() const
 	return KNullDesC;
 	}
 
+/** Query the value of the object as UTF-8. A value set as 16 bit is
+ * converted on the first query. If there is no memory for converting it,
+ * the value is empty until a later query succeeds.
+ * @returns The value, KNullDesC8 if no value.
+ */
+EXPORT_C const TDesC8 & CKeyValue::Value8() const
+	{
+	TRAPD(error, PrepareValue8L());
+	if (error == KErrNone && iValue8)
+		{
+		return *iValue8;
+		}
+	return KNullDesC8;
+	}
+
+/**
+ * Gives the heap the object was created in.
+ * @returns The heap, e.g. the heap of a CXmlArena.
+ */
+const RAllocator * CKeyValue::Heap() const
+	{
+	return iHeap;
+	}
+
+/**
+ * Leaves with KErrNotSupported if the object was created in another heap
+ * than the current heap of the thread, e.g. in a CXmlArena. Its memory
+ * could not be reallocated or freed, see EXmlParseArena.
+ */
+void CKeyValue::CheckHeapL() const
+	{
+	if (iHeap != &User::Allocator())
+		{
+		User::Leave(KErrNotSupported);
+		}
+	}
+
+/** Converts a value set as UTF-8 to 16 bit, in the heap of the object. */
+void CKeyValue::PrepareValueL() const
+	{
+	if (iHeap == &User::Allocator())
+		{
+		iValue = ConversionUtils::ConvertToUnicodeL(*iValue8);
+		return;
+		}
+	// Allocated in the arena of the object, see CXmlArena::SwitchHeapL.
+	RAllocator * previous = CXmlArena::SwitchHeapL(*iHeap);
+	TRAPD(error, iValue = ConversionUtils::ConvertToUnicodeL(*iValue8));
+	CXmlArena::SwitchHeapBack(previous);
+	User::LeaveIfError(error);
+	}
+
+/** Converts a value set as 16 bit to UTF-8, if not converted already,
+ * in the heap of the object. */
+void CKeyValue::PrepareValue8L() const
+	{
+	if (iHeap == &User::Allocator())
+		{
+		DoPrepareValue8L();
+		return;
+		}
+	RAllocator * previous = CXmlArena::SwitchHeapL(*iHeap);
+	TRAPD(error, DoPrepareValue8L());
+	CXmlArena::SwitchHeapBack(previous);
+	User::LeaveIfError(error);
+	}
+
+/** Converts the value to UTF-8 in the heap of the thread, see PrepareValue8L. */
+void CKeyValue::DoPrepareValue8L() const
+	{
+	if (!iValue8 && iValue)
+		{
+		iValue8 = ConversionUtils::ConvertToUtf8L(*iValue);
+		}
+	}
+
 /**
  * Sets the value of the namespace member variable. If the new
  * name length is zero, current namepace is emptied and new
@@ -257,8 +425,8 @@ EXPORT_C const TDesC & CKeyValue::Value() const
  */
 EXPORT_C void CKeyValue::SetNameSpaceL(const TDesC & aNameSpace)
 	{
-	delete iNameSpace;
-	iNameSpace = 0;
+	CheckHeapL();
+	ResetNameSpace();
 	if (aNameSpace.Length() > 0)
 		{
 		iNameSpace = aNameSpace.AllocL();
@@ -270,8 +438,8 @@ EXPORT_C void CKeyValue::SetNameSpaceL(const TDesC & aNameSpace)
  */
 EXPORT_C void CKeyValue::SetKeyL(const TDesC & aKey)
 	{
-	delete iKey;
-	iKey = 0;
+	CheckHeapL();
+	ResetKey();
 	if (aKey.Length() > 0)
 		{
 		iKey = aKey.AllocL();
@@ -283,8 +451,11 @@ EXPORT_C void CKeyValue::SetKeyL(const TDesC & aKey)
  */
 EXPORT_C void CKeyValue::SetValueL(const TDesC & aValue)
 	{
+	CheckHeapL();
 	delete iValue;
 	iValue = 0;
+	delete iValue8;
+	iValue8 = 0;
 	if (aValue.Length() > 0)
 		{
 		iValue = aValue.AllocL();
@@ -294,48 +465,130 @@ EXPORT_C void CKeyValue::SetValueL(const TDesC & aValue)
 /**
  * Sets the value of the namespace member variable, 8 bit version. If the new
  * name length is zero, current namepace is emptied and new
- * one is null.
+ * one is null. The namespace is kept as 8 bit, and widened only if
+ * queried with NameSpace().
  * @param aNameSpace New name of the namespace.
  */
 EXPORT_C void CKeyValue::SetNameSpaceL(const TDesC8 & aNameSpace)
+	{
+	CheckHeapL();
+	ResetNameSpace();
+	if (aNameSpace.Length() > 0)
+		{
+		iNameSpace8 = aNameSpace.AllocL();
+		}
+	}
+
+/**
+ * Sets the namespace, interned in a pool. The object refers to the
+ * pooled namespace instead of a copy of its own, and keeps the pool open.
+ * @param aNameSpace New name of the namespace.
+ * @param aPool The pool to intern the namespace in.
+ */
+EXPORT_C void CKeyValue::SetNameSpaceL(const TDesC8 & aNameSpace, CXmlStringPool & aPool)
+	{
+	CheckHeapL();
+	const HBufC8 * nameSpace = aNameSpace.Length() > 0 ? aPool.InternL(aNameSpace) : 0;
+	ResetNameSpace();
+	if (nameSpace)
+		{
+		UsePool(aPool);
+		iNameSpace8 = const_cast<HBufC8 *>(nameSpace);
+		iNameSpaceIsPooled = ETrue;
+		}
+	}
+
+/**
+ * Sets the key, interned in a pool. The object refers to the
+ * pooled key instead of a copy of its own, and keeps the pool open.
+ * @param aKey The new key.
+ * @param aPool The pool to intern the key in.
+ */
+EXPORT_C void CKeyValue::SetKeyL(const TDesC8 & aKey, CXmlStringPool & aPool)
+	{
+	CheckHeapL();
+	const HBufC8 * key = aKey.Length() > 0 ? aPool.InternL(aKey) : 0;
+	ResetKey();
+	if (key)
+		{
+		UsePool(aPool);
+		iKey8 = const_cast<HBufC8 *>(key);
+		iKeyIsPooled = ETrue;
+		}
+	}
+
+/** Empties the namespace, in both widths. */
+void CKeyValue::ResetNameSpace()
 	{
 	delete iNameSpace;
 	iNameSpace = 0;
-	if (aNameSpace.Length() > 0)
+	if (!iNameSpaceIsPooled)
 		{
-		iNameSpace = HBufC::NewL(aNameSpace.Length());
-		TPtr ptr(iNameSpace->Des());
-		ptr.Copy(aNameSpace);
+		delete iNameSpace8;
 		}
+	iNameSpace8 = 0;
+	iNameSpaceIsPooled = EFalse;
 	}
 
-/** Sets the key for the object.
+/** Empties the key, in both widths. */
+void CKeyValue::ResetKey()
+	{
+	delete iKey;
+	iKey = 0;
+	if (!iKeyIsPooled)
+		{
+		delete iKey8;
+		}
+	iKey8 = 0;
+	iKeyIsPooled = EFalse;
+	}
+
+/**
+ * Opens the pool the key and namespace are interned in. Names interned
+ * in another pool before must have been reset.
+ * @param aPool The pool.
+ */
+void CKeyValue::UsePool(CXmlStringPool & aPool)
+	{
+	if (iPool != &aPool)
+		{
+		aPool.Open();
+		if (iPool)
+			{
+			iPool->Close();
+			}
+		iPool = &aPool;
+		}
+	}
+
+/** Sets the key for the object. The key is kept as 8 bit,
+ * and widened only if queried with Key().
  * @param aKey The new key as 8 bit descriptor.
  */
 EXPORT_C void CKeyValue::SetKeyL(const TDesC8 & aKey)
 	{
-	delete iKey;
-	iKey = 0;
+	CheckHeapL();
+	ResetKey();
 	if (aKey.Length() > 0)
 		{
-		iKey = HBufC::NewL(aKey.Length());
-		TPtr ptr(iKey->Des());
-		ptr.Copy(aKey);
+		iKey8 = aKey.AllocL();
 		}
 	}
 
-/** Sets the value for the object.
+/** Sets the value for the object. The value is kept as UTF-8,
+ * and converted only if queried with Value().
  * @param aValue The new value as 8 bit descriptor.
  */
 EXPORT_C void CKeyValue::SetValueL(const TDesC8 & aValue)
 	{
+	CheckHeapL();
 	delete iValue;
 	iValue = 0;
+	delete iValue8;
+	iValue8 = 0;
 	if (aValue.Length() > 0)
 		{
-		iValue = HBufC::NewL(aValue.Length());
-		TPtr ptr(iValue->Des());
-		ptr.Copy(aValue);
+		iValue8 = aValue.AllocL();
 		}
 	}
 
@@ -348,17 +601,29 @@ EXPORT_C void CKeyValue::SetValueL(const TDesC8 & aValue)
 TInt CKeyValue::ApproximateTextLength() const
 	{
 	TInt len = 0;
-	if (iNameSpace)
+	if (iNameSpace8)
+		{
+		len += iNameSpace8->Length()+1;
+		}
+	else if (iNameSpace)
 		{
 		len += iNameSpace->Length()+1;
 		}
-	if (iKey)
+	if (iKey8)
+		{
+		len += iKey8->Length();
+		}
+	else if (iKey)
 		{
 		len += iKey->Length();
 		}
-	if (iValue)
+	if (iValue8)
 		{
-		len += iValue->Length() + iValue->Length()/10; // Reserve room for escaped chars.
+		len += iValue8->Length() + iValue8->Length()/10; // Reserve room for escaped chars.
+		}
+	else if (iValue)
+		{
+		len += iValue->Length() + iValue->Length()/10;
 		}
 	return len + 4;
 	}
@@ -372,23 +637,25 @@ TInt CKeyValue::ApproximateTextLength() const
  */
 EXPORT_C void CKeyValue::GetAsTextL(TDes8 & aBuffer)
 	{
-	if (iNameSpace)
+	PrepareValue8L();
+	const TBool hasNameSpace = iNameSpace || iNameSpace8;
+	if (hasNameSpace)
 		{
-		aBuffer.Append(*iNameSpace);
+		aBuffer.Append(NameSpace8());
 		}
-	if (iKey)
+	if (iKey || iKey8)
 		{
-		if (iNameSpace)
+		if (hasNameSpace)
 			{
 			aBuffer.Append(KCharColon);
 			}
-		aBuffer.Append(*iKey);
+		aBuffer.Append(Key8());
 		}
 	aBuffer.Append(KCharEquals);
 	aBuffer.Append(KCharQuote);
-	if ((iNameSpace || iKey) && iValue)
+	if ((hasNameSpace || iKey || iKey8) && iValue8)
 		{
-		ConversionUtils::AppendToUtf8BufferEncodedL(*iValue, aBuffer);
+		ConversionUtils::AppendToUtf8BufferEncodedL(*iValue8, aBuffer);
 		}
 	aBuffer.Append(KCharQuote);
 	}
@@ -418,6 +685,37 @@ TInt CKeyValue::Compare(const CKeyValue & aFirst, const CKeyValue & aSecond)
 	return 0; // Objects are equal.
 	}
 
+/** Checks if the object has a namespace and a key. Names interned in the
+ * same pool as the ones given are compared by address, others by content.
+ * @param aNameSpace The namespace.
+ * @param aKey The key.
+ * @param aPool The pool the names were looked up in, or 0.
+ * @param aPooledNameSpace The namespace in aPool, 0 if not there.
+ * @param aPooledKey The key in aPool, 0 if not there.
+ * @returns ETrue if the object has the namespace and the key.
+ */
+TBool CKeyValue::Matches(const TDesC8 & aNameSpace, const TDesC8 & aKey, const CXmlStringPool * aPool,
+		const HBufC8 * aPooledNameSpace, const HBufC8 * aPooledKey) const
+	{
+	const TBool samePool = aPool && iPool == aPool;
+	if (samePool && iKeyIsPooled)
+		{
+		if (iKey8 != aPooledKey)
+			{
+			return EFalse;
+			}
+		}
+	else if (Key8() != aKey)
+		{
+		return EFalse;
+		}
+	if (samePool && iNameSpaceIsPooled)
+		{
+		return iNameSpace8 == aPooledNameSpace;
+		}
+	return NameSpace8() == aNameSpace;
+	}
+
 /**
  * Accepts a visitor to visit this object.
  * @param aVisitor The visitor.
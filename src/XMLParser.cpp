@@ -25,11 +25,18 @@
 
 //  Include Files  
 #include <bautils.h>
+#include <hal.h>
 #include <xml\attribute.h>
 #include <xml\parserfeature.h>
 
 #include "XMLParser.h"	// CXMLParser
 #include "XmlDocument.h"
+#include "XmlByteSource.h"
+#include "XmlTokenizer.h"
+#include "XmlParallelParser.h"
+#include "XmlPathFilter.h"
+#include "XmlStringPool.h"
+#include "XmlArena.h"
 #include "XMLParserConstants.h"
 
 #ifdef USE_DEBUGLOGGER
@@ -47,32 +54,69 @@ namespace ajj
 {
 
 /**
- * Creates a new XML parser.
+ * Creates a new XML parser, using the Symbian XML parser for tokenizing.
  * @returns The XML parser object.
  */
 EXPORT_C CXmlParser* CXmlParser::NewL(MXmlParserObserver & aObserver)
+	{
+	return CXmlParser::NewL(aObserver, EXmlTokenizerPlatform);
+	}
+
+/**
+ * Creates a new XML parser, using the given tokenizer. The native
+ * tokenizer is faster, and does not need the XML framework plugin,
+ * but does not parse DTDs, see CXmlTokenizer.
+ * @param aObserver The observer of the parser.
+ * @param aTokenizer The tokenizer to use.
+ * @returns The XML parser object.
+ */
+EXPORT_C CXmlParser* CXmlParser::NewL(MXmlParserObserver & aObserver, TXmlTokenizer aTokenizer)
 	{
 	CXmlParser* self = new (ELeave) CXmlParser(aObserver);
 	CleanupStack::PushL(self);
-	self->ConstructL();
+	self->ConstructL(aTokenizer);
 	CleanupStack::Pop(self);
 	return self;
 	}
 
 /** Default constructor, initializes base class and member variables. */
 CXmlParser::CXmlParser(MXmlParserObserver & aObserver)
-: CActive(CActive::EPriorityLow), iObserver(aObserver), iBytesToParseInStep(2048), iIsParsing(EFalse), iDoSynchronously(EFalse)
+: CActive(CActive::EPriorityLow), iObserver(&aObserver), iFileWindowSize(KXmlDefaultFileWindowSize),
+  iOptions(EXmlParseDefault), iParallelism(KXmlDefaultParallelism), iBytesToParseInStep(KXmlDefaultParseStep), iIsParsing(EFalse), iDoSynchronously(EFalse)
 	{
 	}
 
 /** 2nd phase constructor.
- * Connects to the file server and creates the XML parser.
+ * Connects to the file server and creates the tokenizer. The features
+ * of the Symbian XML parser stay enabled for all the documents parsed.
+ * @param aTokenizer The tokenizer to use.
  */
-void CXmlParser::ConstructL()
+void CXmlParser::ConstructL(TXmlTokenizer aTokenizer)
 	{
 	_LIT8(KMIMETextXml, "text/xml");
 	User::LeaveIfError(iFs.Connect());
-	iXmlParser = Xml::CParser::NewL(KMIMETextXml, *this);
+	if (aTokenizer == EXmlTokenizerNative)
+		{
+		iTokenizer = CXmlTokenizer::NewL(*this);
+		}
+	else
+		{
+		iXmlParser = Xml::CParser::NewL(KMIMETextXml, *this);
+		TInt result = iXmlParser->EnableFeature(Xml::EReportNamespaces);
+		result = iXmlParser->EnableFeature(Xml::EReportNamespacePrefixes);
+		result = iXmlParser->EnableFeature(Xml::EReportNamespaceMapping);
+		result = iXmlParser->EnableFeature(Xml::ESendFullContentInOneChunk);
+		}
+	User::LeaveIfError(HAL::Get(HAL::EFastCounterFrequency, iFastCounterFrequency));
+	TInt countsUp = ETrue;
+	if (HAL::Get(HAL::EFastCounterCountsUp, countsUp) == KErrNone)
+		{
+		iFastCounterCountsUp = countsUp;
+		}
+	else
+		{
+		iFastCounterCountsUp = ETrue;
+		}
 #ifdef USE_DEBUGLOGGER
 	iLogger = oy::tol::CDebugLogger::Instance();
 #endif
@@ -89,14 +133,25 @@ void CXmlParser::ConstructL()
 EXPORT_C CXmlParser::~CXmlParser()
 	{
 	Cancel();
+	CloseSource();
 	iFs.Close();
 	delete iFileBuffer;
+	delete iRecordNameSpace;
+	delete iRecordName;
+	// Frees what is left of an unfinished document at once.
+	delete ReleaseArena();
+	if (iNamePool)
+		{
+		iNamePool->Close();
+		}
 	using namespace Xml;
 	delete iXmlParser;
+	delete iTokenizer;
 	iElements.Reset(); // Client takes ownership of objects!!
 	iElements.Close();
 	iXmlNameSpaces.Reset(); // Objects moved to the topmost CXmlElement when done parsing.
 	iXmlNameSpaces.Close();
+	iContent.Close();
 	}
 
 /**
@@ -112,8 +167,69 @@ EXPORT_C TVersion CXmlParser::Version() const
 	}
 
 /**
- * Parsers a XML file, synchronously. Use only for small files.
- * @todo If using large files, read and parse in pieces.
+ * Sets the options for parsing. Takes effect when the next
+ * parse is started.
+ * @param aOptions The options, a combination of TXmlParserOptions flags.
+ */
+EXPORT_C void CXmlParser::SetOptions(TUint aOptions)
+	{
+	iOptions = aOptions;
+	}
+
+/**
+ * Query the options for parsing.
+ * @returns The options, a combination of TXmlParserOptions flags.
+ */
+EXPORT_C TUint CXmlParser::Options() const
+	{
+	return iOptions;
+	}
+
+/**
+ * Sets the size of the window used when reading a file in pieces,
+ * see EXmlParseStreamFile. Takes effect when the next parse is started.
+ * @param aWindowSize The window size in bytes, must be positive.
+ */
+EXPORT_C void CXmlParser::SetFileWindowSize(TInt aWindowSize)
+	{
+	if (aWindowSize > 0)
+		{
+		iFileWindowSize = aWindowSize;
+		}
+	}
+
+/**
+ * Sets the budget of one slice of async parsing. By default, one RunL
+ * parses a fixed step of KXmlDefaultParseStep bytes. When a budget is set,
+ * one RunL parses steps until either the time or the byte budget has
+ * been used, and the step size adapts to the measured throughput. This
+ * keeps the active scheduler responsive while avoiding a scheduler round
+ * trip and observer callback for every couple of kilobytes.
+ * Takes effect when the next parse is started.
+ * @param aMicroSeconds The time budget of a slice, e.g. 5000. 0 for no time budget.
+ * @param aMaxBytes The byte budget of a slice, 0 for no byte budget.
+ */
+EXPORT_C void CXmlParser::SetSliceBudget(TInt aMicroSeconds, TInt aMaxBytes)
+	{
+	iSliceTimeBudget = Max(aMicroSeconds, 0);
+	iSliceByteBudget = Max(aMaxBytes, 0);
+	}
+
+/**
+ * Sets how many pieces a file is parsed in at the same time with the
+ * option EXmlParseParallel. One piece is parsed in the calling thread,
+ * each of the others in a worker thread. Pays off only on devices with
+ * more than one CPU core. Takes effect when the next parse is started.
+ * @param aPieceCount The count of pieces, at least 2 for parallel parsing.
+ */
+EXPORT_C void CXmlParser::SetParallelism(TInt aPieceCount)
+	{
+	iParallelism = aPieceCount;
+	}
+
+/**
+ * Parsers a XML file, synchronously. For large files, set the
+ * option EXmlParseStreamFile to read and parse the file in pieces.
  * @param aFileName The file containing the XML.
  * @returns KErrNone if all went well.
  */
@@ -127,8 +243,13 @@ EXPORT_C TInt CXmlParser::ParseXmlFileSyncL(const TDesC & aFileName)
 
 
 /**
- * Parsers a XML file, asyncronously.
- * @todo If using large files, read and parse in pieces.
+ * Parsers a XML file, asyncronously. If the option EXmlParseMapFile is set
+ * and the file can be addressed directly, it is parsed in place. Otherwise,
+ * if the option EXmlParseStreamFile is set, the file is read and parsed
+ * in windows, and if neither applies, the whole file is read into memory first.
+ * With the option EXmlParseParallel, a large file is parsed in pieces in
+ * parallel, and the observer is notified before this method returns, also
+ * in async parsing.
  * @param aFileName The file containing the XML.
  * @returns KErrNone if all went well.
  */
@@ -142,6 +263,26 @@ EXPORT_C TInt CXmlParser::ParseXmlFileL(const TDesC & aFileName)
 		User::Leave(KErrNotFound);
 		}
 
+	if (iOptions & EXmlParseMapFile)
+		{
+		CXmlMemorySource * mapped = CXmlMemorySource::MapFileL(iFs, aFileName);
+		if (mapped)
+			{
+#ifdef USE_DEBUGLOGGER
+			iLogger->Write(oy::tol::KLogLevelHigh, _L("Parsing mapped file in place"));
+#endif
+			return ParseOwnedSourceL(mapped, KXmlDefaultParseStep, mapped->Buffer());
+			}
+		}
+	if ((iOptions & EXmlParseStreamFile) && !(iOptions & EXmlParseParallel))
+		{
+#ifdef USE_DEBUGLOGGER
+		_LIT(KMsg, "Allocating 2 x %d bytes for file windows");
+		iLogger->Write(oy::tol::KLogLevelHigh, KMsg, iFileWindowSize);
+#endif
+		return ParseOwnedSourceL(CXmlFileSource::NewL(iFs, aFileName, iFileWindowSize), iFileWindowSize);
+		}
+
 	RFile file;
 	User::LeaveIfError(file.Open(iFs, aFileName, EFileRead));
 	CleanupClosePushL(file);
@@ -156,12 +297,16 @@ EXPORT_C TInt CXmlParser::ParseXmlFileL(const TDesC & aFileName)
 #endif
 	iFileBuffer = HBufC8::NewL(size);
 	TPtr8 ptr(iFileBuffer->Des());
-//TODO: read file in pieces if file size > some constant max size.
-	file.Read(ptr);
+	User::LeaveIfError(file.Read(ptr));
+	if ((iOptions & EXmlParseParallel) && ParseInParallelL(*iFileBuffer))
+		{
+		CleanupStack::PopAndDestroy(); // file
+		return iError;
+		}
 #ifdef USE_DEBUGLOGGER
 	iLogger->Write(oy::tol::KLogLevelHigh, _L("Start parsing now, xml in memory..."));
 #endif
-	iError = ParseXmlBufferL(*iFileBuffer);
+	iError = ParseOwnedSourceL(CXmlMemorySource::NewL(*iFileBuffer), KXmlDefaultParseStep, *iFileBuffer);
 #ifdef USE_DEBUGLOGGER
 	if (iDoSynchronously)
 		{
@@ -189,6 +334,59 @@ EXPORT_C TInt CXmlParser::ParseXmlBufferSyncL(const TDesC8 & aBuffer)
 	return iError;
 	}
 
+/**
+ * Parses a piece of XML, e.g. received from a socket. The first call starts
+ * parsing a new document, following calls continue it, until FinishL
+ * is called. The pieces are given to the Symbian XML parser as they are,
+ * so the whole document is never in memory, and the piece can be reused by
+ * the caller when this method returns. Elements may be split between pieces
+ * anywhere. Observer's FragmentParsedL is called after each piece.
+ * @param aChunk The next piece of the XML document.
+ */
+EXPORT_C void CXmlParser::FeedL(const TDesC8 & aChunk)
+	{
+	if (!iIsFeeding)
+		{
+		Cancel();
+		CloseSource();
+#ifdef USE_DEBUGLOGGER
+		iLogger->Write(oy::tol::KLogLevelHigh, _L("FeedL starts a new document"));
+#endif
+		PrepareParsingL();
+		iIsFeeding = ETrue;
+		iIsParsing = ETrue;
+		}
+	if (iError != KErrNone || aChunk.Length() == 0)
+		{
+		// Observer has already been notified of the error in OnError.
+		return;
+		}
+	TokenizeL(aChunk);
+	if (iError == KErrNone)
+		{
+		iObserver->FragmentParsedL();
+		}
+	}
+
+/**
+ * Ends parsing of the document fed in with FeedL. Observer's
+ * ParsingFinishedL is called, unless parsing has already failed
+ * and the observer been notified of the error.
+ * @returns KErrNone if all went well.
+ */
+EXPORT_C TInt CXmlParser::FinishL()
+	{
+	if (iIsFeeding)
+		{
+		iIsFeeding = EFalse;
+		if (iError == KErrNone)
+			{
+			ParsingEndedL();
+			}
+		}
+	return iError;
+	}
+
 
 /**
  * Parses a buffer containing XML. Does the parsing either synchronously or 
@@ -201,81 +399,593 @@ EXPORT_C TInt CXmlParser::ParseXmlBufferSyncL(const TDesC8 & aBuffer)
  */
 EXPORT_C TInt CXmlParser::ParseXmlBufferL(const TDesC8 & aBuffer)
 	{
-	Cancel();
 #ifdef USE_DEBUGLOGGER
 	iLogger->Write(oy::tol::KLogLevelHigh, _L("ParseXMLBufferL start"));
 #endif
+	return ParseOwnedSourceL(CXmlMemorySource::NewL(aBuffer), KXmlDefaultParseStep);
+	}
+
+/**
+ * Parses XML read from a source, asynchronously. The source is not owned
+ * by the parser, and must stay alive until the parsing has finished.
+ * The observer is notified as with ParseXmlBufferL.
+ * @param aSource The source of the XML.
+ * @returns KErrNone if parsing started successfully.
+ */
+EXPORT_C TInt CXmlParser::ParseSourceL(MXmlByteSource & aSource)
+	{
+	Cancel();
+	CloseSource();
+	StartParsingL(aSource, KXmlDefaultParseStep);
+	return iError;
+	}
+
+/**
+ * Parses XML read from a source, synchronously.
+ * @param aSource The source of the XML.
+ * @returns KErrNone if all went well.
+ */
+EXPORT_C TInt CXmlParser::ParseSourceSyncL(MXmlByteSource & aSource)
+	{
+	iDoSynchronously = ETrue;
+	ParseSourceL(aSource);
+	iDoSynchronously = EFalse;
+	return iError;
+	}
+
+/**
+ * Parses XML read from a source created by the parser itself.
+ * @param aSource The source of the XML, owned by the parser from now on.
+ * @param aBlockSize Size of the blocks to request from the source.
+ * @param aInput The whole XML if it stays in memory after parsing, so
+ * that values can be views into it, see EXmlParseViewValues.
+ * @returns KErrNone if parsing started successfully.
+ */
+TInt CXmlParser::ParseOwnedSourceL(MXmlByteSource * aSource, TInt aBlockSize, const TDesC8 & aInput)
+	{
+	Cancel();
+	CloseSource();
+	if (iOptions & EXmlParseViewValues)
+		{
+		iInput.Set(aInput);
+		}
+	iOwnedSource = aSource;
+	StartParsingL(*aSource, aBlockSize);
+	return iError;
+	}
+
+/**
+ * Parses a document in memory in pieces at the same time, see
+ * EXmlParseParallel and CXmlParallelParser. The observer is notified
+ * before this method returns.
+ * @param aXml The document.
+ * @returns EFalse if the document is too small or cannot be split, and was not parsed.
+ */
+TBool CXmlParser::ParseInParallelL(const TDesC8 & aXml)
+	{
+	if (aXml.Length() < KXmlMinParallelSize || iParallelism < 2 || iSaxHandler || iRecordObserver || iPathFilter || iElementHook
+			|| (iOptions & EXmlParseArena))
+		{
+		return EFalse;
+		}
+	CXmlParallelParser * parallel = CXmlParallelParser::NewLC(
+			iTokenizer ? EXmlTokenizerNative : EXmlTokenizerPlatform, iParallelism);
+	if (!parallel->SplitL(aXml))
+		{
+		CleanupStack::PopAndDestroy(parallel);
+		return EFalse;
+		}
+#ifdef USE_DEBUGLOGGER
+	iLogger->Write(oy::tol::KLogLevelHigh, _L("Parsing xml in parallel..."));
+#endif
+	Cancel();
+	CloseSource();
+	iIsFeeding = EFalse;
+	iError = KErrNone;
+	ClearDocument();
+	iIsParsing = EFalse;
+	const TInt error = parallel->ParseL(iElements);
+	CleanupStack::PopAndDestroy(parallel);
+	iError = error;
+	iObserver->ParsingFinishedL(iError);
+	return ETrue;
+	}
+
+/**
+ * Resets the state of the parser for a new document and
+ * begins a new parse in the Symbian XML parser.
+ */
+void CXmlParser::PrepareParsingL()
+	{
 	iError = 0;
-	iElements.Reset();
-	iXmlNameSpaces.Reset();
+	ClearDocument();
+	if ((iOptions & EXmlParseArena) && !iSaxHandler && !iRecordObserver)
+		{
+		// The names of the document are interned in the arena too.
+		if (iNamePool)
+			{
+			iNamePool->Close();
+			iNamePool = 0;
+			}
+		iArena = CXmlArena::NewL();
+		}
+	if (iPathFilter)
+		{
+		iPathFilter->Reset();
+		}
+	TokenizeBeginL();
+	}
+
+/** Begins a new document in the tokenizer. */
+void CXmlParser::TokenizeBeginL()
+	{
+	if (iTokenizer)
+		{
+		iTokenizer->ParseBeginL();
+		}
+	else
+		{
+		iXmlParser->ParseBeginL();
+		}
+	}
+
+/**
+ * Gives a piece of the XML to the tokenizer, which calls
+ * the MContentHandler methods of this class.
+ * @param aXml The piece of XML.
+ */
+void CXmlParser::TokenizeL(const TDesC8 & aXml)
+	{
+	if (iTokenizer)
+		{
+		iTokenizer->ParseL(aXml);
+		}
+	else
+		{
+		iXmlParser->ParseL(aXml);
+		}
+	}
+
+/** Ends the document in the tokenizer. */
+void CXmlParser::TokenizeEndL()
+	{
+	if (iTokenizer)
+		{
+		iTokenizer->ParseEndL();
+		}
+	else
+		{
+		iXmlParser->ParseEndL();
+		}
+	}
+
+/**
+ * Destroys what is left of the previous document in the parser: the
+ * elements not retrieved with GetElementsL, the namespace definitions and
+ * a partly parsed tree. The arrays keep their memory for the next document.
+ */
+void CXmlParser::ClearDocument()
+	{
+	// Everything in the arena is freed with it at the end.
+	const TBool inArena = (iArena != 0);
+	if (iCurrentElement && !inArena)
+		{
+		// Parsing ended before the topmost element did, so it is not in iElements.
+		CXmlElement * topmost = iCurrentElement;
+		while (topmost->Parent())
+			{
+			topmost = topmost->Parent();
+			}
+		delete topmost;
+		}
 	iCurrentElement = 0;
+	iPreviousElement = 0;
+	iContent.Zero();
+	iContentView.Set(KNullDesC8);
+	iDepth = 0;
+	iSkipDepth = 0;
+	// Removing from the end does not move the other pointers or free the array.
+	for (TInt index = iElements.Count() - 1; index >= 0; --index)
+		{
+		if (!inArena)
+			{
+			delete iElements[index];
+			}
+		iElements.Remove(index);
+		}
+	for (TInt index = iXmlNameSpaces.Count() - 1; index >= 0; --index)
+		{
+		if (!inArena)
+			{
+			delete iXmlNameSpaces[index];
+			}
+		iXmlNameSpaces.Remove(index);
+		}
+	delete ReleaseArena();
+	}
 
-	iCurrentParseIndex = 0;
-	iXmlString.Set(aBuffer);
-	
-	iXmlParser->ParseBeginL();
-	TInt result = iXmlParser->EnableFeature(Xml::EReportNamespaces);
-	result = iXmlParser->EnableFeature(Xml::EReportNamespacePrefixes);
-	result = iXmlParser->EnableFeature(Xml::EReportNamespaceMapping);
-	result = iXmlParser->EnableFeature(Xml::ESendFullContentInOneChunk);
-	
+/**
+ * Gives up the arena of the document, see EXmlParseArena. The name pool
+ * is in the arena, so the next document gets a new one.
+ * @returns The arena, 0 if not used.
+ */
+CXmlArena * CXmlParser::ReleaseArena()
+	{
+	CXmlArena * arena = iArena;
+	if (arena)
+		{
+		iArena = 0;
+		iNamePool = 0;
+		}
+	return arena;
+	}
+
+/**
+ * Stops parsing, and resets the parser for a new document. Elements not
+ * retrieved with GetElementsL are destroyed. The Symbian XML parser, the
+ * file server session and the memory of the internal arrays are kept, so
+ * parsing many small documents with the same parser costs little more
+ * than the parsing itself.
+ */
+EXPORT_C void CXmlParser::Reset()
+	{
+	Cancel();
+	CloseSource();
+	iIsFeeding = EFalse;
+	iIsParsing = EFalse;
+	ClearDocument();
+	iError = KErrNone;
+	delete iFileBuffer;
+	iFileBuffer = 0;
+	// The elements given out keep the pool open as long as they need it.
+	if (iNamePool)
+		{
+		iNamePool->Close();
+		iNamePool = 0;
+		}
+	}
+
+/**
+ * Sets the observer notified of parsing. Use when reusing the parser
+ * for another client, see CXmlParserPool.
+ * @param aObserver The new observer.
+ */
+EXPORT_C void CXmlParser::SetObserver(MXmlParserObserver & aObserver)
+	{
+	iObserver = &aObserver;
+	}
+
+/**
+ * Sets the handler the parsing events are forwarded to. While a handler
+ * is set, no elements are created and GetElementsL gets nothing, so the
+ * memory used does not grow with the document. The observer is still
+ * notified of the progress and the end of the parsing. Files are not parsed
+ * in parallel with a handler, see EXmlParseParallel. Do not change the
+ * handler while parsing.
+ * @param aHandler The handler, 0 to create the elements again. Not owned.
+ */
+EXPORT_C void CXmlParser::SetSaxHandler(MXmlSaxHandler * aHandler)
+	{
+	iSaxHandler = aHandler;
+	}
+
+/**
+ * Sets the observer of records recognized by the namespace and name of the
+ * element. Each record is handed to the observer when it ends, and removed
+ * from the tree, so the memory used while parsing is that of one record
+ * and its ancestors, not of the whole document. A record inside a record
+ * is handed to the observer before, and apart from, the enclosing one. Files are not parsed in parallel with a record
+ * observer, see EXmlParseParallel. Do not change the observer while parsing.
+ * @param aObserver The observer, not owned.
+ * @param aNameSpace The namespace prefix of the record elements, as in CXmlElement::NameSpace().
+ * @param aName The name of the record elements, e.g. Placemark.
+ */
+EXPORT_C void CXmlParser::SetRecordObserverL(MXmlRecordObserver & aObserver,
+		const TDesC & aNameSpace, const TDesC & aName)
+	{
+	HBufC * nameSpace = aNameSpace.AllocLC();
+	// Compared with the 8 bit names of the elements, which are not widened.
+	HBufC8 * name = HBufC8::NewL(aName.Length());
+	name->Des().Copy(aName);
+	CleanupStack::Pop(nameSpace);
+	ClearRecordObserver();
+	iRecordNameSpace = nameSpace;
+	iRecordName = name;
+	iRecordObserver = &aObserver;
+	}
+
+/**
+ * Sets the observer of records recognized by their depth in the
+ * document, see the other overload.
+ * @param aObserver The observer, not owned.
+ * @param aDepth The depth of the record elements, 0 for the topmost element,
+ * 1 for its children and so on.
+ */
+EXPORT_C void CXmlParser::SetRecordObserver(MXmlRecordObserver & aObserver, TInt aDepth)
+	{
+	ClearRecordObserver();
+	iRecordDepth = aDepth;
+	iRecordObserver = &aObserver;
+	}
+
+/** Removes the observer of records, the whole tree is kept again. */
+EXPORT_C void CXmlParser::ClearRecordObserver()
+	{
+	iRecordObserver = 0;
+	delete iRecordNameSpace;
+	iRecordNameSpace = 0;
+	delete iRecordName;
+	iRecordName = 0;
+	iRecordDepth = 0;
+	}
+
+/**
+ * Sets the filter selecting the elements created. Elements outside the
+ * paths of the filter are skipped without creating them, their attributes
+ * or values, and the elements on the way to the selected ones are created
+ * without their attributes and values, see CXmlPathFilter. With a record
+ * observer, the depth of the records is counted in the elements created,
+ * which is the depth in the document for the records on a path. Files are
+ * not parsed in parallel with a filter, see EXmlParseParallel. Do not
+ * change the filter while parsing.
+ * @param aFilter The filter, 0 to create all elements. Not owned.
+ */
+EXPORT_C void CXmlParser::SetPathFilter(CXmlPathFilter * aFilter)
+	{
+	iPathFilter = aFilter;
+	}
+
+/**
+ * Sets the hook deciding at the start of each element if the element is
+ * parsed or skipped. A skipped element and everything in it is neither
+ * created nor forwarded to the MXmlSaxHandler. With EXmlTokenizerNative,
+ * the tokenizer fast-forwards to the matching end tag counting only the
+ * nesting, without allocating, converting or decoding anything, see
+ * CXmlTokenizer::SkipElement. The elements skipped by a CXmlPathFilter
+ * are fast-forwarded in the same way. Files are not parsed in parallel
+ * with a hook, see EXmlParseParallel. Do not change the hook while parsing.
+ * @param aHook The hook, 0 to parse all elements. Not owned.
+ */
+EXPORT_C void CXmlParser::SetElementHook(MXmlElementHook * aHook)
+	{
+	iElementHook = aHook;
+	}
+
+/**
+ * Starts skipping the element starting, see SetElementHook.
+ */
+void CXmlParser::SkipElement()
+	{
+	if (iTokenizer)
+		{
+		iTokenizer->SkipElement();
+		}
+	}
+
+/**
+ * Checks if the element ending is a record, see SetRecordObserverL.
+ * @param aElement The element, the current one.
+ * @returns ETrue if the element is a record.
+ */
+TBool CXmlParser::IsRecord(const CXmlElement & aElement) const
+	{
+	if (iRecordName)
+		{
+		return aElement.Name8() == *iRecordName && aElement.NameSpace() == *iRecordNameSpace;
+		}
+	return iDepth - 1 == iRecordDepth;
+	}
+
+/**
+ * Starts parsing the input from a source. In async parsing, requests the
+ * first block and returns, in sync parsing, parses all of the input before
+ * returning.
+ * @param aSource The source of the XML.
+ * @param aBlockSize Size of the blocks to request from the source.
+ */
+void CXmlParser::StartParsingL(MXmlByteSource & aSource, TInt aBlockSize)
+	{
+	iIsFeeding = EFalse;
+	PrepareParsingL();
+	iBytesToParseInStep = aBlockSize;
+	iSource = &aSource;
+	iIsParsing = ETrue;
+	RequestBlock();
 	// Start async parsing.
 	if (!iDoSynchronously)
 		{
-		ParseNextFragmentL();
+		// RunL parses the block when the request completes.
+		SetActive();
+		iReadPending = EFalse;
 #ifdef USE_DEBUGLOGGER
-		iLogger->Write(oy::tol::KLogLevelHigh, _L("Started parsing first fragment."));
+		iLogger->Write(oy::tol::KLogLevelHigh, _L("Requested first fragment."));
 #endif	
 		}
 	else
 		{
-		do
+		while (iIsParsing)
 			{
-			ParseNextFragmentL();
+			User::WaitForRequest(iStatus);
+			iReadPending = EFalse;
+			TRAPD(error, ParseBlockL());
+			if (error != KErrNone)
+				{
+				CloseSource();
+				iIsParsing = EFalse;
+				User::Leave(error);
+				}
 #ifdef USE_DEBUGLOGGER
 			iLogger->Write(oy::tol::KLogLevelHigh, _L("parsing fragments...."));
 #endif	
-			} while (iIsParsing);
+			}
 		}
-	return iError;
 	}
 
 /**
- * Parses the next fragment of the XML.
- * Parses a piece of the XML and sets the active object active.
- * When RunL is called, it calls this function again. If there's
- * nothing left to parse, the object is not set active, but
- * ParsingEndedL is called.
+ * Requests the next block of iBytesToParseInStep bytes from the source.
+ */
+void CXmlParser::RequestBlock()
+	{
+	iSource->ReadBlock(iBytesToParseInStep, iStatus);
+	iReadPending = ETrue;
+	}
+
+/**
+ * Parses the next fragment of the XML, called by RunL when the block
+ * requested from the source is there. Parses the block and sets the
+ * active object active to wait for the next one. When parsing in time
+ * budgeted slices, the blocks the source has already completed are
+ * parsed in the same slice, until the budget has been used. If there's
+ * nothing left to parse, the object is not set active, but ParsingEndedL
+ * is called.
  */
 void CXmlParser::ParseNextFragmentL()
 	{
 #ifdef USE_DEBUGLOGGER
 	iLogger->Write(oy::tol::KLogLevelMedium, _L("In ParseNextFragmentL"));
 #endif
-	TInt length = Min(iBytesToParseInStep, iXmlString.Length()-iCurrentParseIndex);
-	if (iCurrentParseIndex < iXmlString.Length() && length > 0)
+	const TBool sliced = iSliceTimeBudget > 0 || iSliceByteBudget > 0;
+	const TUint32 start = User::FastCounter();
+	TInt parsed = 0;
+	FOREVER
 		{
-		TPtrC8 ptr(iXmlString.Mid(iCurrentParseIndex, length));
+		TInt length = ParseBlockL();
+		parsed += length;
+		if (length == 0 || !iIsParsing || iError != KErrNone || !sliced)
+			{
+			break;
+			}
+		if ((iSliceTimeBudget > 0 && MicroSecondsSince(start) >= iSliceTimeBudget)
+				|| (iSliceByteBudget > 0 && parsed >= iSliceByteBudget)
+				|| iStatus.Int() == KRequestPending)
+			{
+			break;
+			}
+		// The next block is already there, parse it in this slice.
+		User::WaitForRequest(iStatus);
+		iReadPending = EFalse;
+		}
+	if (sliced)
+		{
+		AdaptStepSize(parsed, MicroSecondsSince(start));
+		}
+	if (iReadPending)
+		{
+		SetActive();
+		iReadPending = EFalse;
+		}
+	}
+
+/**
+ * Parses the block of the completed request, after requesting the next
+ * block from the source, so the source can read it while this one is parsed.
+ * Ends the parsing when the source returns an empty block.
+ * @returns The count of bytes parsed, 0 if there was nothing left to parse.
+ */
+TInt CXmlParser::ParseBlockL()
+	{
+	User::LeaveIfError(iStatus.Int());
+	TPtrC8 block(iSource->Block());
+	if (block.Length() == 0)
+		{
+		ParsingEndedL();
+		return 0;
+		}
+	RequestBlock();
 #ifdef USE_DEBUGLOGGER
-		iLogger->Write(oy::tol::KLogLevelDetails, ptr);
+	_LIT(KMsg, "Parsing a block of %d bytes");
+	iLogger->Write(oy::tol::KLogLevelDetails, KMsg, block.Length());
 #endif
-		iXmlParser->ParseL(ptr);
-		iCurrentParseIndex += length;
-		iIsParsing = ETrue;
-		if (!iDoSynchronously)
+	TokenizeL(block);
+	return block.Length();
+	}
+
+/**
+ * Cancels the block requested from the source, if the request
+ * is outstanding and not waited for by the active scheduler.
+ */
+void CXmlParser::CancelSourceRead()
+	{
+	if (iReadPending)
+		{
+		iSource->CancelRead();
+		User::WaitForRequest(iStatus);
+		iReadPending = EFalse;
+		}
+	}
+
+/**
+ * Stops reading the source, and deletes it if the parser created it.
+ * A request waited for by the active scheduler must have been cancelled
+ * by calling Cancel() before.
+ */
+void CXmlParser::CloseSource()
+	{
+	CancelSourceRead();
+	iSource = 0;
+	delete iOwnedSource;
+	iOwnedSource = 0;
+	iInput.Set(KNullDesC8);
+	}
+
+/**
+ * Checks if data reported by the tokenizer is in the XML kept in memory,
+ * so that a value can be a view into it, see EXmlParseViewValues.
+ * @param aData The data.
+ * @returns ETrue if the data is in the XML kept.
+ */
+TBool CXmlParser::IsInInput(const TDesC8 & aData) const
+	{
+	return iInput.Length() > 0 && aData.Ptr() >= iInput.Ptr()
+		&& aData.Ptr() + aData.Length() <= iInput.Ptr() + iInput.Length();
+	}
+
+/**
+ * Adapts the step size so that a slice takes a few steps. The step
+ * granularity then bounds how much a slice overshoots its time budget,
+ * without parsing in needlessly small steps.
+ * @param aBytes Bytes parsed in the last slice.
+ * @param aMicroSeconds Time the last slice took.
+ */
+void CXmlParser::AdaptStepSize(TInt aBytes, TInt aMicroSeconds)
+	{
+	const TInt KStepsPerSlice = 4;
+	const TInt KMinStep = 512;
+	const TInt KMaxStep = 262144;
+	TInt step = iBytesToParseInStep;
+	if (iSliceTimeBudget > 0)
+		{
+		if (aMicroSeconds > 0)
 			{
-			SetActive();			
-			TRequestStatus* status = &iStatus;
-			User::RequestComplete(status, KErrNone);
+			TInt64 bytesPerSlice = TInt64(aBytes) * iSliceTimeBudget / aMicroSeconds;
+			step = I64LOW(Min(bytesPerSlice / KStepsPerSlice, TInt64(KMaxStep)));
+			}
+		else if (aBytes > 0)
+			{
+			// Too fast to measure, grow the step.
+			step = Min(step * 2, KMaxStep);
 			}
 		}
-	else
+	if (iSliceByteBudget > 0)
 		{
-		ParsingEndedL();
+		step = Min(step, Max(iSliceByteBudget / KStepsPerSlice, 1));
 		}
+	iBytesToParseInStep = Max(step, KMinStep);
 	}
 
-/** Called when the parsing has ended. Calls Xml::CParser::ParseEndL
+/**
+ * Calculates the time elapsed since a fast counter value.
+ * @param aStartCount Value of User::FastCounter() at the start.
+ * @returns Elapsed time in microseconds.
+ */
+TInt CXmlParser::MicroSecondsSince(TUint32 aStartCount) const
+	{
+	const TUint32 now = User::FastCounter();
+	const TUint32 ticks = iFastCounterCountsUp ? now - aStartCount : aStartCount - now;
+	return I64LOW(TInt64(ticks) * 1000000 / iFastCounterFrequency);
+	}
+
+/** Called when the parsing has ended. Ends the document in the tokenizer
  * and notifies the observer.
  */
 void CXmlParser::ParsingEndedL()
@@ -283,9 +993,14 @@ void CXmlParser::ParsingEndedL()
 #ifdef USE_DEBUGLOGGER
 	iLogger->Write(oy::tol::KLogLevelMedium, _L("In ParsingEndedL"));
 #endif
-	iXmlParser->ParseEndL();
+	CloseSource();
+	TokenizeEndL();
 	iIsParsing = EFalse;
-	iObserver.ParsingFinishedL(KErrNone);
+	if (iError == KErrNone)
+		{
+		// Otherwise the observer has been notified in OnError.
+		iObserver->ParsingFinishedL(KErrNone);
+		}
 	}
 
 /**
@@ -297,10 +1012,29 @@ void CXmlParser::ParsingEndedL()
  */
 EXPORT_C void CXmlParser::GetElementsL(RXmlElementArray & aArray)
 	{
-	while (iElements.Count() > 0)
+	if (iArena && iElements.Count() > 0)
+		{
+		// The elements are freed with the arena, see GetElementsL(CXmlDocument&).
+		User::Leave(KErrNotSupported);
+		}
+	const TInt count = iElements.Count();
+	aArray.ReserveL(aArray.Count() + count);
+	for (TInt index = 0; index < count; ++index)
+		{
+		if (iOptions & EXmlParseViewValues)
+			{
+			// The XML viewed is freed with the next document.
+			iElements[index]->CopyValueViewsL();
+			}
+		}
+	for (TInt index = 0; index < count; ++index)
 		{
-		aArray.AppendL(iElements[0]);
-		iElements.Remove(0);
+		aArray.AppendL(iElements[index]);
+		}
+	// Removing from the end keeps the memory of the array for the next elements.
+	for (TInt index = count - 1; index >= 0; --index)
+		{
+		iElements.Remove(index);
 		}
 	}
 
@@ -309,11 +1043,49 @@ EXPORT_C void CXmlParser::GetElementsL(RXmlElementArray & aArray)
  * Ownership of the result is with the client, so you must call this method
  * and destroy the results when no longer needed. When calling this method,
  * the elements are also removed from the parser's container to save memory.
+ * With EXmlParseArena, the arena of the elements is handed to the document
+ * too, and this method leaves with KErrInUse while parsing. With
+ * EXmlParseViewValues, the file read is handed to the document after
+ * parsing, and the value views of the elements are copied while parsing.
  * @param aDocument The XML document where to place the parsed elements.
  */
 EXPORT_C void CXmlParser::GetElementsL(CXmlDocument & aDocument)
 	{
-	aDocument.AddElementsL(iElements);
+	if (iArena && iIsParsing)
+		{
+		User::Leave(KErrInUse);
+		}
+	if ((iOptions & EXmlParseViewValues) && iIsParsing)
+		{
+		// The XML viewed is still parsed, and freed with the next document.
+		const TInt count = iElements.Count();
+		for (TInt index = 0; index < count; ++index)
+			{
+			iElements[index]->CopyValueViewsL();
+			}
+		}
+	else if ((iOptions & EXmlParseViewValues) && iFileBuffer)
+		{
+		// The values of the elements may be views into the file read, so it
+		// goes first. If it cannot, it is destroyed, and the elements with it.
+		HBufC8 * buffer = iFileBuffer;
+		iFileBuffer = 0;
+		TRAPD(error, aDocument.AdoptBufferL(buffer));
+		if (error != KErrNone)
+			{
+			ClearDocument();
+			User::Leave(error);
+			}
+		}
+	if (iArena)
+		{
+		aDocument.AdoptArenaL(iElements, iArena);
+		ReleaseArena();
+		}
+	else
+		{
+		aDocument.AddElementsL(iElements);
+		}
 	}
 
 
@@ -333,11 +1105,23 @@ void CXmlParser::OnStartDocumentL(
 void CXmlParser::OnEndDocumentL(TInt aErrorCode)
 	{
 	iIsParsing = EFalse;
+	FlushContentL();
 	if (iElements.Count() > 0)
 		{
 		// Add the namespace definitions to the topmost/first
 		// xml element. XML elemet removes the pointers from iXmlNameSpaces.
-		iElements[0]->AddAttributesL(iXmlNameSpaces);
+		if (iArena)
+			{
+			RAllocator * previous = CXmlArena::SwitchHeapL(iArena->Heap());
+			TRAPD(error, MoveNameSpacesL(*iElements[0]));
+			CXmlArena::SwitchHeapBack(previous);
+			User::LeaveIfError(error);
+			iXmlNameSpaces.Reset();
+			}
+		else
+			{
+			iElements[0]->AddAttributesL(iXmlNameSpaces);
+			}
 		}
 #ifdef USE_DEBUGLOGGER
 	_LIT(KMsg, "OnEndDocumentL, error: %d");
@@ -353,6 +1137,47 @@ void CXmlParser::OnEndDocumentL(TInt aErrorCode)
  * @param aPrefix The namespace prefixm e.g. atom.
  */
 void CXmlParser::AddToNameSpacesListL(const TDesC8 & aUri, const TDesC8 & aPrefix)
+	{
+	if (iArena)
+		{
+		// The definition is created in the arena, but the array is not,
+		// so it must not grow while the arena is the heap.
+		iXmlNameSpaces.ReserveL(iXmlNameSpaces.Count() + 1);
+		RAllocator * previous = CXmlArena::SwitchHeapL(iArena->Heap());
+		TRAPD(error, DoAddToNameSpacesListL(aUri, aPrefix));
+		CXmlArena::SwitchHeapBack(previous);
+		User::LeaveIfError(error);
+		}
+	else
+		{
+		DoAddToNameSpacesListL(aUri, aPrefix);
+		}
+	}
+
+/**
+ * Adds the namespace definitions to an element in the arena, see
+ * EXmlParseArena. The element frees the array it is given, so the
+ * definitions are given to it in an array allocated in the arena.
+ * @param aElement The topmost element.
+ */
+void CXmlParser::MoveNameSpacesL(CXmlElement & aElement)
+	{
+	RKeyValuePairs nameSpaces;
+	CleanupClosePushL(nameSpaces);
+	for (TInt index = 0; index < iXmlNameSpaces.Count(); ++index)
+		{
+		nameSpaces.AppendL(iXmlNameSpaces[index]);
+		}
+	aElement.AddAttributesL(nameSpaces);
+	CleanupStack::PopAndDestroy(&nameSpaces);
+	}
+
+/**
+ * Adds a namespace definition to the array, see AddToNameSpacesListL.
+ * @param aUri The namespace URI.
+ * @param aPrefix The namespace prefix.
+ */
+void CXmlParser::DoAddToNameSpacesListL(const TDesC8 & aUri, const TDesC8 & aPrefix)
 	{
 	// For example, xmlns:atom="http://www.w3.org/2005/Atom"
 	// xmlns and atom are here the namespace qualifier, which are together
@@ -398,7 +1223,66 @@ void CXmlParser::OnStartElementL(const Xml::RTagInfo& aElement,
 	iLogger->Write(oy::tol::KLogLevelDetails, localName);
 	iLogger->Write(oy::tol::KLogLevelDetails, uri);
 #endif
+	if (iSkipDepth > 0)
+		{
+		// Only the Symbian XML parser reports the elements inside a skipped one.
+		++iSkipDepth;
+		return;
+		}
+	if (iElementHook && iElementHook->StartElementL(uri, prefix, localName, aAttributes) == EXmlElementSkip)
+		{
+		iSkipDepth = 1;
+		SkipElement();
+		return;
+		}
+	if (iSaxHandler)
+		{
+		iSaxHandler->StartElementL(uri, prefix, localName, aAttributes);
+		return;
+		}
+	TXmlPathMatch match = EXmlPathSelected;
+	if (iPathFilter)
+		{
+		match = iPathFilter->StartElementL(prefix, localName);
+		if (match == EXmlPathSkip)
+			{
+			SkipElement();
+			return;
+			}
+		}
 	
+	// The ancestors of the selected elements are kept without attributes.
+	const TInt attributeCount = (match == EXmlPathSelected) ? aAttributes.Count() : 0;
+	if (iArena)
+		{
+		// Leaves are trapped while the arena is the heap, see CXmlArena::SwitchHeapL.
+		RAllocator * previous = CXmlArena::SwitchHeapL(iArena->Heap());
+		TRAPD(error, AddElementL(prefix, localName, aAttributes, attributeCount));
+		CXmlArena::SwitchHeapBack(previous);
+		User::LeaveIfError(error);
+		}
+	else
+		{
+		AddElementL(prefix, localName, aAttributes, attributeCount);
+		}
+	}
+
+/**
+ * Creates an element with its attributes, and adds it to the tree
+ * as the current element. With EXmlParseArena, called while the arena
+ * is the heap of the thread.
+ * @param aPrefix The namespace prefix of the element.
+ * @param aLocalName The name of the element.
+ * @param aAttributes The attributes of the element.
+ * @param aAttributeCount The count of the attributes to add.
+ */
+void CXmlParser::AddElementL(const TDesC8 & aPrefix, const TDesC8 & aLocalName,
+		const Xml::RAttributeArray & aAttributes, TInt aAttributeCount)
+	{
+	if (!iNamePool)
+		{
+		iNamePool = CXmlStringPool::NewL();
+		}
 	CXmlElement * newElement = new (ELeave) CXmlElement;
 	CleanupStack::PushL(newElement);
 	if (iCurrentElement)
@@ -413,39 +1297,82 @@ void CXmlParser::OnStartElementL(const Xml::RTagInfo& aElement,
 		iCurrentElement = newElement;
 		CleanupStack::Pop(); // newElement
 		}
-	newElement->SetNameSpace(prefix);
-	newElement->SetNameL(localName);
-	for (TInt counter = 0; counter < aAttributes.Count(); ++counter)
+	++iDepth;
+	newElement->SetNameSpace(aPrefix);
+	newElement->SetNameL(aLocalName, *iNamePool);
+	for (TInt counter = 0; counter < aAttributeCount; ++counter)
 		{
 		const Xml::RAttribute & attr = aAttributes[counter];
-		CKeyValue * keyValue = CKeyValue::NewLC(attr.Attribute().LocalName().DesC(), attr.Value().DesC());
+		CKeyValue * keyValue = new (ELeave) CKeyValue;
+		CleanupStack::PushL(keyValue);
+		keyValue->SetKeyL(attr.Attribute().LocalName().DesC(), *iNamePool);
+		// The value is kept as UTF-8, and converted only when queried.
+		keyValue->SetValueL(attr.Value().DesC());
 		TPtrC8 namesp = attr.Attribute().Prefix().DesC();
-		TPtrC8 value = attr.Value().DesC();
 		if (namesp.Length() > 0)
 			{
-			keyValue->SetNameSpaceL(namesp);
+			keyValue->SetNameSpaceL(namesp, *iNamePool);
 			}
 		newElement->AddAttributeL(keyValue);
 		CleanupStack::Pop(); // keyValue
 #ifdef USE_DEBUGLOGGER
-		_LIT(KMsg, " Attribute %d: %S:%S=%S, (error: %d)");
-		iLogger->Write(oy::tol::KLogLevelDetails, KMsg, counter, &keyValue->NameSpace(), &keyValue->Key(), &keyValue->Value(), aErrorCode);
+		_LIT(KMsg, " Attribute %d: %S:%S=%S");
+		iLogger->Write(oy::tol::KLogLevelDetails, KMsg, counter, &keyValue->NameSpace(), &keyValue->Key(), &keyValue->Value());
 #endif
 		}
 	}
 
 /** See Symbian XML parser doc on this method. */
-void CXmlParser::OnEndElementL(const Xml::RTagInfo& /*aElement*/, TInt aErrorCode)
+void CXmlParser::OnEndElementL(const Xml::RTagInfo& aElement, TInt aErrorCode)
 	{
-	if (iCurrentElement)
+	// The value of the element, or of its last child, is complete.
+	FlushContentL();
+	if (iSkipDepth > 0)
 		{
+		// The element was skipped by the hook, so it is not in the tree.
+		--iSkipDepth;
+		}
+	else if (iSaxHandler)
+		{
+		iSaxHandler->EndElementL(aElement.Uri().DesC(), aElement.Prefix().DesC(), aElement.LocalName().DesC());
+		}
+	else if (iPathFilter && !iPathFilter->EndElement())
+		{
+		// The element was skipped, so it is not in the tree.
+		}
+	else if (iCurrentElement)
+		{
+		CXmlElement * parent = iCurrentElement->Parent();
+		if (iRecordObserver && IsRecord(*iCurrentElement))
+			{
+			// The record is the last child of its parent, removed without moving the others.
+			CXmlElement * record = iCurrentElement;
+			if (parent)
+				{
+				parent->RemoveChild(parent->ChildCount() - 1);
+				}
+			iCurrentElement = parent;
+			// The observer may delete the record, and a new element be allocated at its address.
+			iPreviousElement = 0;
+			--iDepth;
+			if (iOptions & EXmlParseViewValues)
+				{
+				// The record outlives the XML its values are views into.
+				CleanupStack::PushL(record);
+				record->CopyValueViewsL();
+				CleanupStack::Pop(record);
+				}
+			iRecordObserver->RecordParsedL(record);
+			return;
+			}
 		// If current element has no parent, it is a topmost element
 		// and will be put on the elements array.
-		if (!iCurrentElement->Parent())
+		if (!parent)
 			{
 			iElements.AppendL(iCurrentElement);
 			}
-		iCurrentElement = iCurrentElement->Parent();
+		iCurrentElement = parent;
+		--iDepth;
 		}
 
 #ifdef USE_DEBUGLOGGER
@@ -457,30 +1384,140 @@ void CXmlParser::OnEndElementL(const Xml::RTagInfo& /*aElement*/, TInt aErrorCod
 /** See Symbian XML parser doc on this method. */
 void CXmlParser::OnContentL(const TDesC8& aBytes, TInt aErrorCode)
 	{
-	if (aBytes.Length() > 0)
+	if (iSkipDepth > 0)
+		{
+		return;
+		}
+	if (iSaxHandler)
+		{
+		if (aBytes.Length() > 0)
+			{
+			iSaxHandler->ContentL(aBytes);
+			}
+		}
+	else if (aBytes.Length() > 0 && (!iPathFilter || iPathFilter->IsSelected()))
 		{
-		HBufC8 * tmp = aBytes.AllocLC();
-		TPtr8 ptr(tmp->Des());
 #ifdef USE_DEBUGLOGGER
 		_LIT(KMsg, "OnContentL error: %d");
 		iLogger->Write(oy::tol::KLogLevelDetails, KMsg, aErrorCode);
-		iLogger->Write(oy::tol::KLogLevelDetails, *tmp);
+		iLogger->Write(oy::tol::KLogLevelDetails, aBytes);
 #endif
 
-		if (iCurrentElement)
+		AccumulateContentL(aBytes);
+		}
+	}
+
+/**
+ * Gathers content of the current element into iContent. The buffer at
+ * least doubles when it grows, and the value is set, decoded and trimmed
+ * once when the element ends, so a value arriving in many pieces costs
+ * time in proportion to its length. With EXmlParseViewValues, pieces
+ * following each other in the XML parsed are gathered into iContentView
+ * instead, and copied to iContent only if a piece is elsewhere. Content
+ * following a child with content replaces the value set before the child,
+ * as it always has.
+ * @param aBytes The content.
+ */
+void CXmlParser::AccumulateContentL(const TDesC8 & aBytes)
+	{
+	if (!iCurrentElement)
+		{
+		return;
+		}
+	if (iCurrentElement != iPreviousElement)
+		{
+		FlushContentL();
+		iPreviousElement = iCurrentElement;
+		iContentIsAddition = EFalse;
+		}
+	if ((iOptions & EXmlParseViewValues) && iContent.Length() == 0 && IsInInput(aBytes))
+		{
+		if (iContentView.Length() == 0)
+			{
+			iContentView.Set(aBytes);
+			return;
+			}
+		if (aBytes.Ptr() == iContentView.Ptr() + iContentView.Length())
+			{
+			iContentView.Set(iContentView.Ptr(), iContentView.Length() + aBytes.Length());
+			return;
+			}
+		}
+	const TInt required = iContent.Length() + iContentView.Length() + aBytes.Length();
+	if (required > iContent.MaxLength())
+		{
+		// In the heap of the thread also with EXmlParseArena, the buffer is the parser's.
+		iContent.ReAllocL(Max(required, iContent.MaxLength() * 2));
+		}
+	iContent.Append(iContentView);
+	iContentView.Set(KNullDesC8);
+	iContent.Append(aBytes);
+	}
+
+/**
+ * Sets the content gathered by AccumulateContentL as the value of
+ * iPreviousElement, or adds it to the value if some has been set already.
+ */
+void CXmlParser::FlushContentL()
+	{
+	if (iContent.Length() == 0 && iContentView.Length() == 0)
+		{
+		return;
+		}
+	if (iArena)
+		{
+		RAllocator * previous = CXmlArena::SwitchHeapL(iArena->Heap());
+		TRAPD(error, DoFlushContentL());
+		CXmlArena::SwitchHeapBack(previous);
+		User::LeaveIfError(error);
+		}
+	else
+		{
+		DoFlushContentL();
+		}
+	}
+
+/**
+ * Gives the gathered content to the element, see FlushContentL. With
+ * EXmlParseLazyValues or EXmlParseViewValues, the content is not decoded,
+ * and a view is given as a view. With EXmlParseArena, called while the
+ * arena is the heap of the thread.
+ */
+void CXmlParser::DoFlushContentL()
+	{
+	if (iContentView.Length() > 0)
+		{
+		if (iContentIsAddition)
 			{
-			if (iCurrentElement == iPreviousElement)
-				{
-				iCurrentElement->AddToValueL(*tmp);
-				}
-			else
-				{
-				iCurrentElement->SetValueL(*tmp);
-				iPreviousElement = iCurrentElement;
-				}
+			iPreviousElement->AddToValueLazyL(iContentView);
+			}
+		else
+			{
+			iPreviousElement->SetValueViewL(iContentView);
 			}
-		CleanupStack::PopAndDestroy(); // tmp
 		}
+	else if (iOptions & (EXmlParseLazyValues | EXmlParseViewValues))
+		{
+		if (iContentIsAddition)
+			{
+			iPreviousElement->AddToValueLazyL(iContent);
+			}
+		else
+			{
+			iPreviousElement->SetValueLazyL(iContent);
+			}
+		}
+	else if (iContentIsAddition)
+		{
+		iPreviousElement->AddToValueL(iContent);
+		}
+	else
+		{
+		iPreviousElement->SetValueL(iContent);
+		}
+	iContentIsAddition = ETrue;
+	iContent.Zero();
+	iContentView.Set(KNullDesC8);
 	}
 
 /** See Symbian XML parser doc on this method. */
@@ -493,7 +1530,18 @@ void CXmlParser::OnStartPrefixMappingL(const RString& aPrefix,
 	msg.Format(KMsg, &aPrefix.DesC(), &aUri.DesC());
 	iLogger->Write(oy::tol::KLogLevelDetails, msg);
 #endif
-	AddToNameSpacesListL(aUri.DesC(), aPrefix.DesC());
+	if (iSkipDepth > 0)
+		{
+		return;
+		}
+	if (iSaxHandler)
+		{
+		iSaxHandler->StartPrefixMappingL(aPrefix.DesC(), aUri.DesC());
+		}
+	else
+		{
+		AddToNameSpacesListL(aUri.DesC(), aPrefix.DesC());
+		}
 	}
 
 /** See Symbian XML parser doc on this method. */
@@ -506,6 +1554,10 @@ void CXmlParser::OnEndPrefixMappingL(const RString& aPrefix,
 	msg.Format(KMsg, &aPrefix.DesC());
 	iLogger->Write(oy::tol::KLogLevelDetails, msg);
 #endif
+	if (iSaxHandler && iSkipDepth == 0)
+		{
+		iSaxHandler->EndPrefixMappingL(aPrefix.DesC());
+		}
 	}
 
 /** See Symbian XML parser doc on this method. */
@@ -548,8 +1600,10 @@ void CXmlParser::OnError(TInt aErrorCode)
 	if ( iError != KErrNone)
 		{
 		Cancel();
+		// The source is not deleted here, the block being parsed is in it.
+		CancelSourceRead();
 		iIsParsing = EFalse;
-		iObserver.ParsingFinishedL(aErrorCode);
+		iObserver->ParsingFinishedL(aErrorCode);
 		}
 	}
 
@@ -560,38 +1614,42 @@ TAny* CXmlParser::GetExtendedInterface(const TInt32 /*aUid*/)
 	}
 
 
-/** Cancels an outstanding request, in this case does nothing. */
+/** Cancels an outstanding request, the block requested from the source. */
 void CXmlParser::DoCancel()
 	{
 	iIsParsing = EFalse;
+	if (iSource)
+		{
+		iSource->CancelRead();
+		}
 #ifdef USE_DEBUGLOGGER
 	iLogger->Write(oy::tol::KLogLevelDetails, _L("In CXmlParser::DoCancel."));
 #endif
 	}
 
 /**
- * Called after parsing a piece of XML.
- * Notifies the observer and starts parsing another piece.
+ * Called when the block requested from the source is there.
+ * Parses it, requesting another one, and notifies the observer.
  */
 void CXmlParser::RunL()
 	{
 #ifdef USE_DEBUGLOGGER
 	iLogger->Write(oy::tol::KLogLevelDetails, _L("In CXmlParser::RunL."));
 #endif
-	// Notify observer of new content.
-	iObserver.FragmentParsedL();
-	// Parse the next fragment of XML.
+	ParseNextFragmentL();
 	if (iIsParsing)
 		{
-		ParseNextFragmentL();
+		// Notify observer of new content.
+		iObserver->FragmentParsedL();
 		}
 	}
 
 /**
- * Called when RunL leaves. In this case just
- * return the error variable. This will result to a Panic.
+ * Called when RunL leaves, e.g. when reading the source fails.
+ * The outstanding request is cancelled, the source closed and
+ * the observer notified of the error.
  * @param aError The error code
- * @returns The error code.
+ * @returns KErrNone, the error has been handled.
  */
 TInt CXmlParser::RunError(TInt aError)
 	{
@@ -600,6 +1658,11 @@ TInt CXmlParser::RunError(TInt aError)
 #ifdef USE_DEBUGLOGGER
 		iLogger->Write(oy::tol::KLogLevelHigh, _L("In CXmlParser::RunError: %d"), aError);
 #endif		
+		Cancel();
+		CloseSource();
+		iIsParsing = EFalse;
+		iError = aError;
+		TRAP_IGNORE(iObserver->ParsingFinishedL(aError));
 		}
 	return KErrNone;
 	}
@@ -0,0 +1,153 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include "XmlArena.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Count of cleanup stack items reserved before switching heaps. */
+const TInt KXmlCleanupReserve = 8;
+
+/**
+ * Creates an arena.
+ * @param aMaxSize The largest size of the arena. The address space is
+ * reserved at once, but memory is committed only as it is needed.
+ * @returns The arena.
+ */
+EXPORT_C CXmlArena * CXmlArena::NewL(TInt aMaxSize)
+	{
+	CXmlArena * self = new (ELeave) CXmlArena(aMaxSize);
+	CleanupStack::PushL(self);
+	self->ConstructL();
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlArena::CXmlArena(TInt aMaxSize)
+: iMaxSize(aMaxSize)
+	{
+	}
+
+/** 2nd phase constructor, creates the heap in a chunk of its own. */
+void CXmlArena::ConstructL()
+	{
+	iHeap = UserHeap::ChunkHeap(0, KXmlArenaGrowBy, iMaxSize, KXmlArenaGrowBy);
+	if (!iHeap)
+		{
+		User::Leave(KErrNoMemory);
+		}
+	}
+
+/**
+ * Destructor, frees all that was allocated in the arena at once,
+ * by closing the chunk of the heap.
+ */
+EXPORT_C CXmlArena::~CXmlArena()
+	{
+	if (iHeap)
+		{
+		iHeap->Close();
+		}
+	}
+
+/**
+ * Gives the heap of the arena, to be used with SwitchHeapL.
+ * @returns The heap.
+ */
+EXPORT_C RAllocator & CXmlArena::Heap()
+	{
+	return *iHeap;
+	}
+
+/**
+ * Checks if memory was allocated in the arena.
+ * @param aCell The memory, e.g. an element.
+ * @returns ETrue if the memory is in the arena.
+ */
+EXPORT_C TBool CXmlArena::Owns(const TAny * aCell) const
+	{
+	const TUint8 * base = reinterpret_cast<const TUint8 *>(iHeap);
+	const TUint8 * cell = static_cast<const TUint8 *>(aCell);
+	return cell >= base && cell < base + iMaxSize;
+	}
+
+/**
+ * Makes a heap the heap of the thread, for code that does not use the
+ * cleanup stack. Does nothing if the heap is the heap of the thread already.
+ * @param aHeap The heap.
+ * @returns The previous heap, to be given to SwitchHeapBack.
+ */
+EXPORT_C RAllocator * CXmlArena::SwitchHeap(RAllocator & aHeap)
+	{
+	if (&aHeap == &User::Allocator())
+		{
+		return 0;
+		}
+	return User::SwitchHeap(&aHeap);
+	}
+
+/**
+ * Makes a heap the heap of the thread. The cleanup stack is allocated
+ * in the previous heap, so room is first reserved in it, for it not to
+ * grow while the heap is switched. A leave while the heap is switched
+ * would free the items on the cleanup stack in the wrong heap, so the code
+ * run until SwitchHeapBack must be in a TRAP of its own, and must not push
+ * more than a few items at a time.
+ * Does nothing if the heap is the heap of the thread already.
+ * @param aHeap The heap.
+ * @returns The previous heap, to be given to SwitchHeapBack.
+ */
+EXPORT_C RAllocator * CXmlArena::SwitchHeapL(RAllocator & aHeap)
+	{
+	if (&aHeap == &User::Allocator())
+		{
+		return 0;
+		}
+	for (TInt count = 0; count < KXmlCleanupReserve; ++count)
+		{
+		CleanupStack::PushL(static_cast<TAny *>(0));
+		}
+	CleanupStack::Pop(KXmlCleanupReserve);
+	return User::SwitchHeap(&aHeap);
+	}
+
+/**
+ * Makes a heap the heap of the thread again, after SwitchHeap or SwitchHeapL.
+ * @param aPrevious The heap returned by them, 0 if the heap was not switched.
+ */
+EXPORT_C void CXmlArena::SwitchHeapBack(RAllocator * aPrevious)
+	{
+	if (aPrevious)
+		{
+		User::SwitchHeap(aPrevious);
+		}
+	}
+
+} // ajj
+} // org
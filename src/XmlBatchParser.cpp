@@ -0,0 +1,485 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <ecom/ecom.h>
+#include "XmlBatchParser.h"
+#include "XmlDocument.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Stack size of the worker threads. */
+const TInt KXmlBatchWorkerStackSize = 0x4000;
+
+/** An input of a batch, and the result of parsing it. */
+class CXmlBatchItem : public CBase
+	{
+public:
+	~CXmlBatchItem();
+
+public:
+	/** The file to parse, 0 if the input is a buffer. */
+	HBufC * iFileName;
+	/** The buffer to parse, owned by the client. */
+	TPtrC8 iBuffer;
+	/** The document parsed, until handed to the observer. */
+	CXmlDocument * iDocument;
+	/** The result of parsing the input. */
+	TInt iError;
+	};
+
+/** Destructor, deletes the document if not handed to the observer. */
+CXmlBatchItem::~CXmlBatchItem()
+	{
+	delete iFileName;
+	delete iDocument;
+	}
+
+/**
+ * A worker thread of a batch, parsing inputs taken from the batch
+ * with a parser of its own until there are none left.
+ */
+class CXmlBatchWorker : public CBase, private MXmlParserObserver
+	{
+public:
+	CXmlBatchWorker(CXmlBatchParser & aBatch);
+	~CXmlBatchWorker();
+	void CreateL();
+	void Resume();
+
+private:
+	static TInt ThreadFunction(TAny * aWorker);
+	void ThreadMainL();
+	// From MXmlParserObserver
+	virtual void FragmentParsedL();
+	virtual void ParsingFinishedL(TInt aError);
+
+private:
+	/** The batch the inputs are taken from. */
+	CXmlBatchParser & iBatch;
+	/** The worker thread. */
+	RThread iThread;
+	/** Completed when the worker thread exits. */
+	TRequestStatus iExitStatus;
+	/** ETrue when the thread has been created and logged on to. */
+	TBool iCreated;
+	/** ETrue when the thread has been resumed. */
+	TBool iResumed;
+	};
+
+/** Constructor, initializes the member variables. */
+CXmlBatchWorker::CXmlBatchWorker(CXmlBatchParser & aBatch)
+: iBatch(aBatch)
+	{
+	}
+
+/** Destructor, waits for the thread to exit, or kills it if it was never resumed. */
+CXmlBatchWorker::~CXmlBatchWorker()
+	{
+	if (iCreated)
+		{
+		if (!iResumed)
+			{
+			iThread.Kill(KErrNone);
+			}
+		User::WaitForRequest(iExitStatus);
+		iThread.Close();
+		}
+	}
+
+/**
+ * Creates the thread, suspended. The thread uses the heap of the calling
+ * thread, so the documents it creates can be handed to the observer.
+ */
+void CXmlBatchWorker::CreateL()
+	{
+	User::LeaveIfError(iThread.Create(KNullDesC, CXmlBatchWorker::ThreadFunction,
+			KXmlBatchWorkerStackSize, &User::Allocator(), this));
+	iThread.Logon(iExitStatus);
+	if (iExitStatus.Int() != KRequestPending)
+		{
+		// The exit could not be waited for, so the thread must not run.
+		iThread.Kill(KErrNone);
+		iThread.Close();
+		User::Leave(iExitStatus.Int());
+		}
+	iCreated = ETrue;
+	}
+
+/** Lets the thread run. */
+void CXmlBatchWorker::Resume()
+	{
+	iResumed = ETrue;
+	iThread.Resume();
+	}
+
+/**
+ * The function the worker threads start in. When the last worker exits,
+ * the inputs still in the queue are failed, so that the batch always ends.
+ * @param aWorker The worker.
+ * @returns KErrNone, or the error the worker left with.
+ */
+TInt CXmlBatchWorker::ThreadFunction(TAny * aWorker)
+	{
+	CXmlBatchWorker * worker = static_cast<CXmlBatchWorker *>(aWorker);
+	TInt error = KErrNoMemory;
+	CTrapCleanup * cleanup = CTrapCleanup::New();
+	if (cleanup)
+		{
+		TRAP(error, worker->ThreadMainL());
+		// The platform tokenizer is an ECom plugin, whose session is per thread.
+		REComSession::FinalClose();
+		delete cleanup;
+		}
+	worker->iBatch.WorkerExited(error);
+	return error;
+	}
+
+/** Parses inputs taken from the batch until there are none left. */
+void CXmlBatchWorker::ThreadMainL()
+	{
+	CActiveScheduler * scheduler = new (ELeave) CActiveScheduler;
+	CleanupStack::PushL(scheduler);
+	CActiveScheduler::Install(scheduler);
+	CXmlParser * parser = CXmlParser::NewL(*this, iBatch.iTokenizer);
+	CleanupStack::PushL(parser);
+	TInt index = iBatch.TakeItem();
+	while (index != KErrNotFound)
+		{
+		TRAPD(error, iBatch.ParseItemL(*parser, index));
+		iBatch.ItemDone(index, error);
+		parser->Reset();
+		index = iBatch.TakeItem();
+		}
+	CleanupStack::PopAndDestroy(2, scheduler); // parser, scheduler
+	}
+
+/** See MXmlParserObserver. The elements are taken when the parsing has ended. */
+void CXmlBatchWorker::FragmentParsedL()
+	{
+	}
+
+/** See MXmlParserObserver. The error is returned by the sync parsing too. */
+void CXmlBatchWorker::ParsingFinishedL(TInt /*aError*/)
+	{
+	}
+
+/**
+ * Creates a batch parser.
+ * @param aObserver The observer notified of the documents.
+ * @param aThreadCount The count of worker threads, e.g. the count of CPU cores.
+ * @param aTokenizer The tokenizer the parsers of the workers use.
+ * @returns The batch parser.
+ */
+EXPORT_C CXmlBatchParser * CXmlBatchParser::NewL(MXmlBatchObserver & aObserver,
+		TInt aThreadCount, TXmlTokenizer aTokenizer)
+	{
+	CXmlBatchParser * self = new (ELeave) CXmlBatchParser(aObserver, aThreadCount, aTokenizer);
+	CleanupStack::PushL(self);
+	self->ConstructL();
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlBatchParser::CXmlBatchParser(MXmlBatchObserver & aObserver, TInt aThreadCount, TXmlTokenizer aTokenizer)
+: CActive(CActive::EPriorityStandard), iObserver(aObserver), iThreadCount(Max(aThreadCount, 1)),
+  iTokenizer(aTokenizer)
+	{
+	}
+
+/** 2nd phase constructor, creates the lock and the handle the workers complete iStatus with. */
+void CXmlBatchParser::ConstructL()
+	{
+	User::LeaveIfError(iLock.CreateLocal());
+	User::LeaveIfError(iThread.Open(RThread().Id(), EOwnerProcess));
+	CActiveScheduler::Add(this);
+	}
+
+/**
+ * Destructor, stops the batch. The documents not handed
+ * to the observer are destroyed.
+ */
+EXPORT_C CXmlBatchParser::~CXmlBatchParser()
+	{
+	Cancel();
+	StopWorkers();
+	iItems.ResetAndDestroy();
+	iDone.Close();
+	iLock.Close();
+	iThread.Close();
+	}
+
+/**
+ * Adds a file to the batch.
+ * @param aFileName The file containing the XML.
+ */
+EXPORT_C void CXmlBatchParser::AddFileL(const TDesC & aFileName)
+	{
+	CXmlBatchItem * item = new (ELeave) CXmlBatchItem;
+	CleanupStack::PushL(item);
+	item->iFileName = aFileName.AllocL();
+	AddItemL(item);
+	CleanupStack::Pop(item);
+	}
+
+/**
+ * Adds a buffer to the batch.
+ * @param aBuffer The buffer containing the XML, must stay valid until parsed.
+ */
+EXPORT_C void CXmlBatchParser::AddBufferL(const TDesC8 & aBuffer)
+	{
+	CXmlBatchItem * item = new (ELeave) CXmlBatchItem;
+	CleanupStack::PushL(item);
+	item->iBuffer.Set(aBuffer);
+	AddItemL(item);
+	CleanupStack::Pop(item);
+	}
+
+/**
+ * Query the count of inputs in the batch.
+ * @returns The count of inputs.
+ */
+EXPORT_C TInt CXmlBatchParser::Count() const
+	{
+	return iItems.Count();
+	}
+
+/**
+ * Starts parsing the batch on the worker threads, asynchronously.
+ * The observer is notified of each document, and finally of the end
+ * of the batch. Leaves with KErrInUse if the batch has been started.
+ */
+EXPORT_C void CXmlBatchParser::StartL()
+	{
+	if (iStarted)
+		{
+		User::Leave(KErrInUse);
+		}
+	iStarted = ETrue;
+	const TInt count = iItems.Count();
+	iDone.ReserveL(count);
+	const TInt threads = Min(iThreadCount, count);
+	iWorkers.ReserveL(threads);
+	for (TInt index = 0; index < threads; ++index)
+		{
+		CXmlBatchWorker * worker = new (ELeave) CXmlBatchWorker(*this);
+		iWorkers.AppendL(worker); // Room was reserved, does not leave.
+		worker->CreateL();
+		}
+	if (count == 0)
+		{
+		iStatus = KRequestPending;
+		SetActive();
+		TRequestStatus * status = &iStatus;
+		User::RequestComplete(status, KErrNone);
+		return;
+		}
+	iRunningWorkers = threads;
+	Arm();
+	for (TInt index = 0; index < threads; ++index)
+		{
+		iWorkers[index]->Resume();
+		}
+	}
+
+/**
+ * Adds an input to the batch.
+ * @param aItem The input, owned by the batch when this method returns.
+ */
+void CXmlBatchParser::AddItemL(CXmlBatchItem * aItem)
+	{
+	if (iStarted)
+		{
+		User::Leave(KErrInUse);
+		}
+	iItems.AppendL(aItem);
+	}
+
+/** Makes iStatus wait for a worker to complete it. Called with iLock held, or before the workers run. */
+void CXmlBatchParser::Arm()
+	{
+	iStatus = KRequestPending;
+	iArmed = ETrue;
+	SetActive();
+	}
+
+/** Stops the workers after the inputs being parsed, and waits for them to exit. */
+void CXmlBatchParser::StopWorkers()
+	{
+	if (iWorkers.Count() > 0)
+		{
+		iLock.Wait();
+		iCancelled = ETrue;
+		iLock.Signal();
+		iWorkers.ResetAndDestroy();
+		}
+	}
+
+/**
+ * Takes the next input from the queue. Called by the worker threads.
+ * @returns Index of the input, KErrNotFound if none are left.
+ */
+TInt CXmlBatchParser::TakeItem()
+	{
+	TInt index = KErrNotFound;
+	iLock.Wait();
+	if (!iCancelled && iNextItem < iItems.Count())
+		{
+		index = iNextItem++;
+		}
+	iLock.Signal();
+	return index;
+	}
+
+/**
+ * Parses an input into a document. Called by the worker threads.
+ * @param aParser The parser of the worker.
+ * @param aIndex Index of the input.
+ */
+void CXmlBatchParser::ParseItemL(CXmlParser & aParser, TInt aIndex)
+	{
+	CXmlBatchItem & item = *iItems[aIndex];
+	if (item.iFileName)
+		{
+		User::LeaveIfError(aParser.ParseXmlFileSyncL(*item.iFileName));
+		}
+	else
+		{
+		User::LeaveIfError(aParser.ParseXmlBufferSyncL(item.iBuffer));
+		}
+	CXmlDocument * document = new (ELeave) CXmlDocument;
+	CleanupStack::PushL(document);
+	aParser.GetElementsL(*document);
+	CleanupStack::Pop(document);
+	item.iDocument = document;
+	}
+
+/**
+ * Queues a parsed input to be handed to the observer, and completes
+ * iStatus if it is waiting. Called by the worker threads.
+ * @param aIndex Index of the input.
+ * @param aError The result of parsing the input.
+ */
+void CXmlBatchParser::ItemDone(TInt aIndex, TInt aError)
+	{
+	iItems[aIndex]->iError = aError;
+	iLock.Wait();
+	iDone.Append(aIndex); // Room was reserved in StartL, does not fail.
+	if (iArmed)
+		{
+		iArmed = EFalse;
+		TRequestStatus * status = &iStatus;
+		iThread.RequestComplete(status, KErrNone);
+		}
+	iLock.Signal();
+	}
+
+/**
+ * Called by a worker thread when it exits. The last one fails the
+ * inputs left in the queue, if the workers failed before parsing them.
+ * @param aError The error the worker left with, or KErrNone.
+ */
+void CXmlBatchParser::WorkerExited(TInt aError)
+	{
+	iLock.Wait();
+	const TBool last = (--iRunningWorkers == 0);
+	iLock.Signal();
+	if (last)
+		{
+		TInt index = TakeItem();
+		while (index != KErrNotFound)
+			{
+			ItemDone(index, (aError != KErrNone) ? aError : KErrGeneral);
+			index = TakeItem();
+			}
+		}
+	}
+
+/** See CActive. Stops the workers. */
+void CXmlBatchParser::DoCancel()
+	{
+	iLock.Wait();
+	iCancelled = ETrue;
+	if (iArmed)
+		{
+		iArmed = EFalse;
+		TRequestStatus * status = &iStatus;
+		User::RequestComplete(status, KErrCancel);
+		}
+	iLock.Signal();
+	StopWorkers();
+	}
+
+/**
+ * See CActive. Hands the inputs parsed to the observer, and
+ * waits for more unless the batch has ended.
+ */
+void CXmlBatchParser::RunL()
+	{
+	iLock.Wait();
+	const TInt done = iDone.Count();
+	if (done < iItems.Count())
+		{
+		Arm();
+		}
+	iLock.Signal();
+	// The workers only append to iDone, so the indexes read are not changed.
+	while (iDelivered < done)
+		{
+		const TInt index = iDone[iDelivered++];
+		CXmlBatchItem & item = *iItems[index];
+		CXmlDocument * document = item.iDocument;
+		item.iDocument = 0;
+		iObserver.DocumentParsedL(index, document, item.iError);
+		}
+	if (iDelivered == iItems.Count())
+		{
+		StopWorkers();
+		iObserver.BatchFinishedL(KErrNone);
+		}
+	}
+
+/**
+ * See CActive. Stops the batch if the observer leaves, and notifies
+ * it of the end of the batch, unless it left when notified of that.
+ * @param aError The error the observer left with.
+ * @returns KErrNone, the error is handled.
+ */
+TInt CXmlBatchParser::RunError(TInt aError)
+	{
+	Cancel();
+	StopWorkers();
+	if (iDelivered < iItems.Count())
+		{
+		TRAP_IGNORE(iObserver.BatchFinishedL(aError));
+		}
+	return KErrNone;
+	}
+
+} // ajj
+} // org
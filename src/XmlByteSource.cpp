@@ -0,0 +1,355 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <s32strm.h>
+
+#include "XmlByteSource.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Completes a request made to a source. */
+LOCAL_C void Complete(TRequestStatus & aStatus, TInt aError)
+	{
+	aStatus = KRequestPending;
+	TRequestStatus * status = &aStatus;
+	User::RequestComplete(status, aError);
+	}
+
+// CXmlMemorySource
+
+/**
+ * Creates a source handing out pieces of a buffer.
+ * @param aBuffer The input, must stay valid while the source is used.
+ * @returns The source object.
+ */
+EXPORT_C CXmlMemorySource * CXmlMemorySource::NewL(const TDesC8 & aBuffer)
+	{
+	return new (ELeave) CXmlMemorySource(aBuffer);
+	}
+
+/**
+ * Creates a source handing out the contents of a file in place, if the
+ * file server can give a direct address for them. Currently this is the
+ * case for files in ROM (XIP), which are mapped to the address space
+ * of every process.
+ * @param aFs File server session to use.
+ * @param aFileName The file.
+ * @returns The source object, or 0 if the file cannot be mapped.
+ */
+EXPORT_C CXmlMemorySource * CXmlMemorySource::MapFileL(RFs & aFs, const TDesC & aFileName)
+	{
+	const TUint8 * address = static_cast<const TUint8 *>(aFs.IsFileInRom(aFileName));
+	if (!address)
+		{
+		return 0;
+		}
+	TEntry entry;
+	User::LeaveIfError(aFs.Entry(aFileName, entry));
+	return CXmlMemorySource::NewL(TPtrC8(address, entry.iSize));
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlMemorySource::CXmlMemorySource(const TDesC8 & aBuffer)
+: iBuffer(aBuffer)
+	{
+	}
+
+/** Destructor, the buffer is owned by the client. */
+EXPORT_C CXmlMemorySource::~CXmlMemorySource()
+	{
+	}
+
+/**
+ * Gives the whole input of the source.
+ * @returns The buffer given to NewL, or the mapped file.
+ */
+EXPORT_C TPtrC8 CXmlMemorySource::Buffer() const
+	{
+	return iBuffer;
+	}
+
+/** See MXmlByteSource. Completes immediately with the next piece of the buffer. */
+void CXmlMemorySource::ReadBlock(TInt aMaxLength, TRequestStatus & aStatus)
+	{
+	const TInt length = Min(aMaxLength, iBuffer.Length() - iOffset);
+	iBlock.Set(iBuffer.Mid(iOffset, length));
+	iOffset += length;
+	Complete(aStatus, KErrNone);
+	}
+
+/** See MXmlByteSource. */
+TPtrC8 CXmlMemorySource::Block() const
+	{
+	return iBlock;
+	}
+
+/** See MXmlByteSource. Requests are never outstanding. */
+void CXmlMemorySource::CancelRead()
+	{
+	}
+
+// CXmlFileSource
+
+/**
+ * Creates a source reading a file in windows.
+ * @param aFs File server session to use.
+ * @param aFileName The file.
+ * @param aWindowSize The size of the windows, two of them are allocated.
+ * @returns The source object.
+ */
+EXPORT_C CXmlFileSource * CXmlFileSource::NewL(RFs & aFs, const TDesC & aFileName, TInt aWindowSize)
+	{
+	CXmlFileSource * self = new (ELeave) CXmlFileSource;
+	CleanupStack::PushL(self);
+	self->ConstructL(aFs, aFileName, aWindowSize);
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlFileSource::CXmlFileSource()
+: iReadPtr(0, 0)
+	{
+	}
+
+/** 2nd phase constructor, allocates the windows and opens the file. */
+void CXmlFileSource::ConstructL(RFs & aFs, const TDesC & aFileName, TInt aWindowSize)
+	{
+	iBlockBuffer = HBufC8::NewL(aWindowSize);
+	iReadBuffer = HBufC8::NewL(aWindowSize);
+	User::LeaveIfError(iFile.Open(aFs, aFileName, EFileRead | EFileShareReadersOnly));
+	}
+
+/** Destructor, closes the file. An outstanding read must have been cancelled. */
+EXPORT_C CXmlFileSource::~CXmlFileSource()
+	{
+	iFile.Close();
+	delete iBlockBuffer;
+	delete iReadBuffer;
+	}
+
+/** See MXmlByteSource. Reads the next window of the file asynchronously. */
+void CXmlFileSource::ReadBlock(TInt aMaxLength, TRequestStatus & aStatus)
+	{
+	// The block read last is the one being parsed now, so
+	// the next one is read into the other buffer.
+	HBufC8 * tmp = iBlockBuffer;
+	iBlockBuffer = iReadBuffer;
+	iReadBuffer = tmp;
+	iReadPtr.Set(iReadBuffer->Des());
+	iFile.Read(iReadPtr, Min(aMaxLength, iReadPtr.MaxLength()), aStatus);
+	}
+
+/** See MXmlByteSource. */
+TPtrC8 CXmlFileSource::Block() const
+	{
+	return iReadPtr;
+	}
+
+/** See MXmlByteSource. */
+void CXmlFileSource::CancelRead()
+	{
+	iFile.ReadCancel();
+	}
+
+// CXmlStreamSource
+
+/**
+ * Creates a source reading a stream.
+ * @param aStream The stream, must stay open while the source is used.
+ * @param aBlockSize The size of the blocks read, two of them are allocated.
+ * @returns The source object.
+ */
+EXPORT_C CXmlStreamSource * CXmlStreamSource::NewL(RReadStream & aStream, TInt aBlockSize)
+	{
+	CXmlStreamSource * self = new (ELeave) CXmlStreamSource(aStream);
+	CleanupStack::PushL(self);
+	self->ConstructL(aBlockSize);
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlStreamSource::CXmlStreamSource(RReadStream & aStream)
+: iStream(aStream)
+	{
+	}
+
+/** 2nd phase constructor, allocates the buffers. */
+void CXmlStreamSource::ConstructL(TInt aBlockSize)
+	{
+	iBlockBuffer = HBufC8::NewL(aBlockSize);
+	iReadBuffer = HBufC8::NewL(aBlockSize);
+	}
+
+/** Destructor, the stream is owned by the client. */
+EXPORT_C CXmlStreamSource::~CXmlStreamSource()
+	{
+	delete iBlockBuffer;
+	delete iReadBuffer;
+	}
+
+/** See MXmlByteSource. Reads the next block of the stream synchronously. */
+void CXmlStreamSource::ReadBlock(TInt aMaxLength, TRequestStatus & aStatus)
+	{
+	TRAPD(error, ReadBlockL(aMaxLength));
+	Complete(aStatus, error);
+	}
+
+/** Reads the next block of the stream into the buffer not handed out.
+ * @param aMaxLength The largest block wanted.
+ */
+void CXmlStreamSource::ReadBlockL(TInt aMaxLength)
+	{
+	HBufC8 * tmp = iBlockBuffer;
+	iBlockBuffer = iReadBuffer;
+	iReadBuffer = tmp;
+	TPtr8 ptr(iBlockBuffer->Des());
+	ptr.Zero();
+	const TInt length = iStream.Source()->ReadL(
+			const_cast<TUint8 *>(ptr.Ptr()), Min(aMaxLength, ptr.MaxLength()));
+	ptr.SetLength(length);
+	}
+
+/** See MXmlByteSource. */
+TPtrC8 CXmlStreamSource::Block() const
+	{
+	return *iBlockBuffer;
+	}
+
+/** See MXmlByteSource. Requests are never outstanding. */
+void CXmlStreamSource::CancelRead()
+	{
+	}
+
+// CXmlPushSource
+
+/**
+ * Creates a source for data pushed to it.
+ * @returns The source object.
+ */
+EXPORT_C CXmlPushSource * CXmlPushSource::NewL()
+	{
+	return new (ELeave) CXmlPushSource;
+	}
+
+/** Constructor. */
+CXmlPushSource::CXmlPushSource()
+	{
+	}
+
+/** Destructor, cancels an outstanding request. */
+EXPORT_C CXmlPushSource::~CXmlPushSource()
+	{
+	CancelRead();
+	iPending.Close();
+	iBlock.Close();
+	iReadBuffer.Close();
+	}
+
+/**
+ * Adds data to the input. An outstanding request is completed with it.
+ * @param aData The data, copied by the source.
+ */
+EXPORT_C void CXmlPushSource::PushL(const TDesC8 & aData)
+	{
+	if (iPending.Length() + aData.Length() > iPending.MaxLength())
+		{
+		iPending.ReAllocL(iPending.Length() + aData.Length());
+		}
+	iPending.Append(aData);
+	if (iReadStatus && iPending.Length() > 0)
+		{
+		CompleteRead(KErrNone);
+		}
+	}
+
+/** Ends the input. An outstanding request is completed with the rest of it. */
+EXPORT_C void CXmlPushSource::End()
+	{
+	iEnded = ETrue;
+	if (iReadStatus)
+		{
+		CompleteRead(KErrNone);
+		}
+	}
+
+/** See MXmlByteSource. Completes when there is data, or the input has ended. */
+void CXmlPushSource::ReadBlock(TInt aMaxLength, TRequestStatus & aStatus)
+	{
+	aStatus = KRequestPending;
+	iReadStatus = &aStatus;
+	iMaxLength = aMaxLength;
+	if (iPending.Length() > 0 || iEnded)
+		{
+		CompleteRead(KErrNone);
+		}
+	}
+
+/** See MXmlByteSource. */
+TPtrC8 CXmlPushSource::Block() const
+	{
+	return iBlock;
+	}
+
+/** See MXmlByteSource. */
+void CXmlPushSource::CancelRead()
+	{
+	if (iReadStatus)
+		{
+		User::RequestComplete(iReadStatus, KErrCancel);
+		}
+	}
+
+/**
+ * Moves the pending data to the next block and completes the outstanding
+ * request. The parser requests the next block before parsing the one it
+ * got, so the data is copied into the other buffer, which is then swapped
+ * with the block handed out.
+ * @param aError The completion code.
+ */
+void CXmlPushSource::CompleteRead(TInt aError)
+	{
+	const TInt length = Min(iMaxLength, iPending.Length());
+	if (length > iReadBuffer.MaxLength())
+		{
+		TInt error = iReadBuffer.ReAlloc(length);
+		if (error != KErrNone)
+			{
+			User::RequestComplete(iReadStatus, error);
+			return;
+			}
+		}
+	iReadBuffer.Copy(iPending.Left(length));
+	iPending.Delete(0, length);
+	iBlock.Swap(iReadBuffer);
+	User::RequestComplete(iReadStatus, aError);
+	}
+
+} // ajj
+} // org
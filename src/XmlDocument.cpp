@@ -23,11 +23,10 @@
  * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
  */
 
-#include <utf.h>
-
 #include "XmlDocument.h"
 #include "XMLParserConstants.h"
 #include "XmlVisitor.h"
+#include "XmlArena.h"
 
 namespace org
 {
@@ -70,18 +69,30 @@ void CXmlDocument::ConstructL(RXmlElementArray & aArray)
 EXPORT_C CXmlDocument::~CXmlDocument()
 	{
 	Reset();
+	iBuffers.ResetAndDestroy();
+	iArenas.ResetAndDestroy();
 	}
 
 /**
  * Resets the document object by resetting the CXmlElement array.
  * If the document owns the array elements, will destroy them, otherwise
- * just empties the array.
+ * just empties the array. Elements in arenas are freed with their
+ * arenas at once, see AdoptArenaL.
  */
 EXPORT_C void CXmlDocument::Reset()
 	{
 	if (iOwnsElements)
 		{
-		iElements.ResetAndDestroy();
+		for (TInt index = iElements.Count() - 1; index >= 0; --index)
+			{
+			if (!InArena(iElements[index]))
+				{
+				delete iElements[index];
+				}
+			}
+		iElements.Reset();
+		iBuffers.ResetAndDestroy();
+		iArenas.ResetAndDestroy();
 		}
 	else
 		{
@@ -95,11 +106,19 @@ EXPORT_C void CXmlDocument::Reset()
  * the elements are removed from the document and the caller is responsible
  * for destroying the CXmlElements when no longer needed. Use Elements()
  * methods to get access to the XML elements without removing them from
- * the document.
+ * the document. Leaves with KErrNotSupported if the document has adopted
+ * an arena or a buffer, see AdoptArenaL and AdoptBufferL, as the elements
+ * would then outlive the memory they are in or refer to.
  * @param aArray The array where elements are moved to.
  */
 EXPORT_C void CXmlDocument::GetElementsL(RXmlElementArray & aArray)
 	{
+	if (iArenas.Count() > 0 || iBuffers.Count() > 0)
+		{
+		// The elements are destroyed with the arenas, and their values
+		// may be views into the buffers, freed with the document.
+		User::Leave(KErrNotSupported);
+		}
 	while (iElements.Count() > 0)
 		{
 		aArray.AppendL(iElements[0]);
@@ -112,10 +131,15 @@ EXPORT_C void CXmlDocument::GetElementsL(RXmlElementArray & aArray)
  */
 EXPORT_C void CXmlDocument::AddElementsL(RXmlElementArray & aArray)
 	{
-	while (aArray.Count() > 0)
+	const TInt count = aArray.Count();
+	iElements.ReserveL(iElements.Count() + count);
+	for (TInt index = 0; index < count; ++index)
+		{
+		iElements.AppendL(aArray[index]);
+		}
+	for (TInt index = count - 1; index >= 0; --index)
 		{
-		iElements.AppendL(aArray[0]);
-		aArray.Remove(0);
+		aArray.Remove(index);
 		}
 	}
 
@@ -128,6 +152,55 @@ EXPORT_C void CXmlDocument::AddElementL(const CXmlElement * aElement)
 	iElements.AppendL(aElement);
 	}
 
+/**
+ * Takes the ownership of a buffer the values of the elements are views
+ * into, see CXmlElement::SetValueViewL. The buffer is destroyed with the
+ * elements, when the document is destroyed or reset. Used by CXmlParser
+ * with the option EXmlParseViewValues.
+ * @param aBuffer The buffer, owned by the document also if this method leaves.
+ */
+EXPORT_C void CXmlDocument::AdoptBufferL(HBufC8 * aBuffer)
+	{
+	CleanupStack::PushL(aBuffer);
+	iBuffers.AppendL(aBuffer);
+	CleanupStack::Pop(aBuffer);
+	}
+
+/**
+ * Adds elements allocated in an arena to this document, removing them
+ * from aArray, and takes the ownership of the arena, see CXmlParser and
+ * EXmlParseArena. The elements in the arena are not destroyed one by one,
+ * but the arena is destroyed when the document is destroyed or reset,
+ * freeing all of them at once. Elements of a document with arenas
+ * cannot be moved out of it with GetElementsL.
+ * @param aArray Array holding the elements to add.
+ * @param aArena The arena of the elements. If this method leaves,
+ * neither the elements nor the arena are taken.
+ */
+EXPORT_C void CXmlDocument::AdoptArenaL(RXmlElementArray & aArray, CXmlArena * aArena)
+	{
+	iArenas.ReserveL(iArenas.Count() + 1);
+	AddElementsL(aArray);
+	iArenas.AppendL(aArena); // Cannot fail, as reserved.
+	}
+
+/**
+ * Checks if an element is in one of the arenas of the document.
+ * @param aElement The element.
+ * @returns ETrue if the element is freed with an arena.
+ */
+TBool CXmlDocument::InArena(const CXmlElement * aElement) const
+	{
+	for (TInt index = 0; index < iArenas.Count(); ++index)
+		{
+		if (iArenas[index]->Owns(aElement))
+			{
+			return ETrue;
+			}
+		}
+	return EFalse;
+	}
+
 /**
  * Get a reference to the array of XML elements in the document.
  * Use this if you do not want to move the elements away from the 
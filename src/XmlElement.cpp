@@ -27,14 +27,41 @@
 #include "XMLParserConstants.h"
 #include "ConversionUtils.h"
 #include "XmlVisitor.h"
+#include "XmlStringPool.h"
+#include "XmlArena.h"
+#include "XMLParser.pan"
 
 namespace org
 {
 namespace ajj
 {
 
-/** Default constructor, no implementation. */
+/**
+ * Compares a 16 bit name to an 8 bit one, without widening it.
+ * @param aName The 16 bit name.
+ * @param aName8 The 8 bit name.
+ * @returns ETrue if the names are equal.
+ */
+LOCAL_C TBool EqualsNarrow(const TDesC & aName, const TDesC8 & aName8)
+	{
+	const TInt length = aName8.Length();
+	if (aName.Length() != length)
+		{
+		return EFalse;
+		}
+	for (TInt index = 0; index < length; ++index)
+		{
+		if (aName[index] != aName8[index])
+			{
+			return EFalse;
+			}
+		}
+	return ETrue;
+	}
+
+/** Default constructor, remembers the heap the element is created in. */
 EXPORT_C CXmlElement::CXmlElement()
+: iHeap(&User::Allocator())
 	{
 	}
 
@@ -44,10 +71,15 @@ EXPORT_C CXmlElement::CXmlElement()
  */
 EXPORT_C CXmlElement::~CXmlElement()
 	{
-	delete iName;
+	ResetName();
 	delete iValue;
+	delete iValueBuffer8;
 	iAttributes.ResetAndDestroy();
 	iChildren.ResetAndDestroy();
+	if (iPool)
+		{
+		iPool->Close();
+		}
 	}
 
 /** Factory method for creating elements with name and value, 8bit version.
@@ -228,11 +260,25 @@ EXPORT_C const TDesC & CXmlElement::NameSpace() const
 	}
 
 /**
- * Query the name of the element.
+ * Query the name of the element. A name set as 8 bit is widened
+ * on the first query. If there is no memory for it, the name is
+ * empty until a later query succeeds.
  * @returns The name of the element.
  */
 EXPORT_C const TDesC & CXmlElement::Name() const
 	{
+	if (!iName && iName8)
+		{
+		// Allocated in the heap of the element, see CXmlArena.
+		RAllocator * previous = CXmlArena::SwitchHeap(*iHeap);
+		iName = HBufC::New(iName8->Length());
+		CXmlArena::SwitchHeapBack(previous);
+		if (!iName)
+			{
+			return KNullDesC;
+			}
+		iName->Des().Copy(*iName8);
+		}
 	if (iName)
 		{
 		return *iName;
@@ -241,11 +287,48 @@ EXPORT_C const TDesC & CXmlElement::Name() const
 	}
 
 /**
- * Query the value of the element.
+ * Query the name of the element, 8bit version. A name set as 16 bit is
+ * narrowed on the first query. If there is no memory for it, the name
+ * is empty until a later query succeeds.
+ * @returns The name of the element.
+ */
+EXPORT_C const TDesC8 & CXmlElement::Name8() const
+	{
+	if (!iName8 && iName)
+		{
+		RAllocator * previous = CXmlArena::SwitchHeap(*iHeap);
+		iName8 = HBufC8::New(iName->Length());
+		CXmlArena::SwitchHeapBack(previous);
+		if (!iName8)
+			{
+			return KNullDesC8;
+			}
+		iName8->Des().Copy(*iName);
+		}
+	if (iName8)
+		{
+		return *iName8;
+		}
+	return KNullDesC8;
+	}
+
+/**
+ * Query the value of the element. A value set as UTF-8 is converted
+ * on the first query, and a value set with SetValueLazyL or SetValueViewL
+ * decoded too. If there is no memory for it, the value is empty until
+ * a later query succeeds, see DecodeValueL.
  * @returns The value of the element.
  */
 EXPORT_C const TDesC & CXmlElement::Value() const
 	{
+	if (!iValue && iValue8.Length() > 0)
+		{
+		TRAPD(error, DecodeValueL());
+		if (error != KErrNone)
+			{
+			return KNullDesC;
+			}
+		}
 	if (iValue)
 		{
 		return *iValue;
@@ -253,6 +336,23 @@ EXPORT_C const TDesC & CXmlElement::Value() const
 	return KNullDesC;
 	}
 
+/**
+ * Query the value of the element as UTF-8. A value set as 16 bit is
+ * converted on the first query, and a value set with SetValueLazyL or
+ * SetValueViewL decoded. If there is no memory for it, the value is
+ * empty until a later query succeeds.
+ * @returns The value of the element.
+ */
+EXPORT_C const TDesC8 & CXmlElement::Value8() const
+	{
+	TRAPD(error, PrepareValue8L());
+	if (error != KErrNone)
+		{
+		return KNullDesC8;
+		}
+	return iValue8;
+	}
+
 /**
  * Sets the XML namespace for the element.
  * @param aNameSpace The namespace.
@@ -277,8 +377,8 @@ EXPORT_C void CXmlElement::SetNameSpace(const TDesC8 & aNameSpace)
  */
 EXPORT_C void CXmlElement::SetNameL(const TDesC & aName)
 	{
-	delete iName;
-	iName = 0;
+	CheckHeapL();
+	ResetName();
 	if (aName.Length() > 0)
 		{
 		iName = aName.AllocL();
@@ -286,19 +386,59 @@ EXPORT_C void CXmlElement::SetNameL(const TDesC & aName)
 	}
 
 /**
- * Sets the XML name for the element, 8bit version.
+ * Sets the XML name for the element, 8bit version. The name is kept
+ * as 8 bit, and widened only if queried with Name().
  * @param aName The element name.
  */
 EXPORT_C void CXmlElement::SetNameL(const TDesC8 & aName)
+	{
+	CheckHeapL();
+	ResetName();
+	if (aName.Length() > 0)
+		{
+		iName8 = aName.AllocL();
+		}
+	}
+
+/**
+ * Sets the XML name for the element, interned in a pool. The element
+ * refers to the pooled name instead of a copy of its own, and keeps
+ * the pool open.
+ * @param aName The element name.
+ * @param aPool The pool to intern the name in.
+ */
+EXPORT_C void CXmlElement::SetNameL(const TDesC8 & aName, CXmlStringPool & aPool)
+	{
+	CheckHeapL();
+	const HBufC8 * name = aName.Length() > 0 ? aPool.InternL(aName) : 0;
+	ResetName();
+	if (name)
+		{
+		if (iPool != &aPool)
+			{
+			aPool.Open();
+			if (iPool)
+				{
+				iPool->Close();
+				}
+			iPool = &aPool;
+			}
+		iName8 = const_cast<HBufC8 *>(name);
+		iNameIsPooled = ETrue;
+		}
+	}
+
+/** Empties the name, in both widths. */
+void CXmlElement::ResetName()
 	{
 	delete iName;
 	iName = 0;
-	if (aName.Length() > 0)
+	if (!iNameIsPooled)
 		{
-		iName = HBufC::NewL(aName.Length());
-		TPtr ptr(iName->Des());
-		ptr.Copy(aName);
+		delete iName8;
 		}
+	iName8 = 0;
+	iNameIsPooled = EFalse;
 	}
 
 /**
@@ -330,8 +470,10 @@ EXPORT_C TBool CXmlElement::ValueIsCData() const
  */
 EXPORT_C void CXmlElement::SetValueL(const TDesC & aValue)
 	{
+	CheckHeapL();
 	delete iValue;
 	iValue = 0;
+	ResetValue8();
 	if (aValue.Length() > 0)
 		{
 		iValue = aValue.AllocL();
@@ -340,20 +482,26 @@ EXPORT_C void CXmlElement::SetValueL(const TDesC & aValue)
 	}
 
 /**
- * Sets the XML value for the element, 8bit version.
+ * Sets the XML value for the element, 8bit version. The value is kept
+ * as UTF-8, with the references decoded, and converted to 16 bit only
+ * if queried with Value().
  * Leaves if cannot allocate the value member variable.
  * @param aValue The element value.
  */
 EXPORT_C void CXmlElement::SetValueL(const TDesC8 & aValue)
 	{
+	CheckHeapL();
 	delete iValue;
 	iValue = 0;
+	ResetValue8();
 	if (aValue.Length() > 0)
 		{
-		iValue = HBufC::NewL(aValue.Length());
-		TPtr ptr(iValue->Des());
-		ConversionUtils::AppendToUnicodeBufferDecodedL(aValue, ptr);
-		Trim();
+		iValueBuffer8 = aValue.AllocL();
+		TPtr8 ptr(iValueBuffer8->Des());
+		ConversionUtils::DecodeReferences(ptr);
+		iValue8.Set(*iValueBuffer8);
+		iValue8IsDecoded = ETrue;
+		TrimValue8L();
 		}
 	}
 
@@ -364,6 +512,7 @@ EXPORT_C void CXmlElement::SetValueL(const TDesC8 & aValue)
  */
 EXPORT_C void CXmlElement::AddToValueL(const TDesC & aValue)
 	{
+	CheckHeapL();
 	HBufC8 * tmp = HBufC8::NewLC(aValue.Length());
 	TPtr8 ptr(tmp->Des());
 	ptr.Copy(aValue);
@@ -378,18 +527,277 @@ EXPORT_C void CXmlElement::AddToValueL(const TDesC & aValue)
  */
 EXPORT_C void CXmlElement::AddToValueL(const TDesC8 & aValue)
 	{
-	TInt newSize = 0;
-	if (iValue)
+	CheckHeapL();
+	if (iValue && iValue8.Length() == 0)
 		{
-		newSize = iValue->Length();
+		// The value was set as 16 bit.
+		iValue = iValue->ReAllocL(iValue->Length() + aValue.Length());
+		TPtr ptr(iValue->Des());
+		ConversionUtils::AppendToUnicodeBufferDecodedL(aValue, ptr);
+		Trim();
+		return;
 		}
-	newSize += aValue.Length(); 
-	iValue = iValue->ReAllocL(newSize);
+	PrepareValue8L();
+	const TInt length = iValue8.Length();
+	HBufC8 * buffer = HBufC8::NewL(length + aValue.Length());
+	TPtr8 ptr(buffer->Des());
+	ptr.Copy(iValue8);
+	ptr.Append(aValue);
+	TPtr8 addition(ptr.MidTPtr(length));
+	ConversionUtils::DecodeReferences(addition);
+	ptr.SetLength(length + addition.Length());
+	delete iValue;
+	iValue = 0;
+	ResetValue8();
+	iValueBuffer8 = buffer;
+	iValue8.Set(*iValueBuffer8);
+	iValue8IsDecoded = ETrue;
+	TrimValue8L();
+	}
 
-	TPtr ptr(iValue->Des());
-	ConversionUtils::AppendToUnicodeBufferDecodedL(aValue, ptr);
+/**
+ * Sets the value of the element, 8bit version, without decoding it.
+ * The UTF-8 is kept as is, and decoded as SetValueL(const TDesC8&)
+ * does only when the value is first queried, so values that are never
+ * read cost no decoding. The CDATA markers are removed at once,
+ * so ValueIsCData() is valid before that.
+ * @param aValue The element value.
+ */
+EXPORT_C void CXmlElement::SetValueLazyL(const TDesC8 & aValue)
+	{
+	CheckHeapL();
+	delete iValue;
+	iValue = 0;
+	ResetValue8();
+	if (aValue.Length() > 0)
+		{
+		iValueBuffer8 = aValue.AllocL();
+		iValue8.Set(*iValueBuffer8);
+		TrimValue8L();
+		}
+	}
+
+/**
+ * Sets the value of the element as a view into memory owned by someone else,
+ * usually the XML the element was parsed from, see CXmlDocument::AdoptBufferL.
+ * The value is not copied, and is decoded as with SetValueLazyL. The element
+ * copies the value to storage of its own only if it is edited or has
+ * references to decode, or if the CDATA markers cannot be removed by
+ * narrowing the view.
+ * @param aValue The element value, must stay valid as long as the element.
+ */
+EXPORT_C void CXmlElement::SetValueViewL(const TDesC8 & aValue)
+	{
+	CheckHeapL();
+	delete iValue;
+	iValue = 0;
+	ResetValue8();
+	iValue8.Set(aValue);
+	TrimValue8L();
+	}
 
-	Trim();
+/**
+ * Adds to the value of the element, 8bit version, without decoding it,
+ * see SetValueLazyL. If the value has already been decoded, the
+ * addition is decoded at once, as with AddToValueL. A view is extended
+ * if the addition follows it in memory.
+ * @param aValue The element value addition.
+ */
+EXPORT_C void CXmlElement::AddToValueLazyL(const TDesC8 & aValue)
+	{
+	CheckHeapL();
+	if (iValue8.Length() == 0 && !iValue)
+		{
+		SetValueLazyL(aValue);
+		}
+	else if (iValue8.Length() == 0 || iValue8IsDecoded)
+		{
+		AddToValueL(aValue);
+		}
+	else if (!iValueBuffer8 && aValue.Ptr() == iValue8.Ptr() + iValue8.Length())
+		{
+		delete iValue;
+		iValue = 0;
+		iValue8.Set(iValue8.Ptr(), iValue8.Length() + aValue.Length());
+		TrimValue8L();
+		}
+	else
+		{
+		HBufC8 * buffer = HBufC8::NewL(iValue8.Length() + aValue.Length());
+		TPtr8 ptr(buffer->Des());
+		ptr.Copy(iValue8);
+		ptr.Append(aValue);
+		delete iValue;
+		iValue = 0;
+		ResetValue8();
+		iValueBuffer8 = buffer;
+		iValue8.Set(*iValueBuffer8);
+		TrimValue8L();
+		}
+	}
+
+/**
+ * Converts the value to 16 bit, if not converted already. Value() converts
+ * it too, but cannot report running out of memory.
+ */
+EXPORT_C void CXmlElement::DecodeValueL() const
+	{
+	if (iHeap == &User::Allocator())
+		{
+		DoDecodeValueL();
+		return;
+		}
+	// Allocated in the arena of the element, see CXmlArena::SwitchHeapL.
+	RAllocator * previous = CXmlArena::SwitchHeapL(*iHeap);
+	TRAPD(error, DoDecodeValueL());
+	CXmlArena::SwitchHeapBack(previous);
+	User::LeaveIfError(error);
+	}
+
+/** Converts the value to 16 bit in the heap of the thread, see DecodeValueL. */
+void CXmlElement::DoDecodeValueL() const
+	{
+	if (!iValue && iValue8.Length() > 0)
+		{
+		DoPrepareValue8L();
+		HBufC * value = HBufC::NewLC(iValue8.Length());
+		TPtr ptr(value->Des());
+		ConversionUtils::AppendToUnicodeBufferL(iValue8, ptr);
+		CleanupStack::Pop(value);
+		iValue = value;
+		}
+	}
+
+/**
+ * Makes iValue8 hold the value as UTF-8 with the references decoded,
+ * converting a value set as 16 bit, or decoding one set without
+ * decoding. A view is copied only if it has references to decode.
+ * The memory is allocated in the heap of the element.
+ */
+void CXmlElement::PrepareValue8L() const
+	{
+	if (iHeap == &User::Allocator())
+		{
+		DoPrepareValue8L();
+		return;
+		}
+	// Allocated in the arena of the element, see CXmlArena::SwitchHeapL.
+	RAllocator * previous = CXmlArena::SwitchHeapL(*iHeap);
+	TRAPD(error, DoPrepareValue8L());
+	CXmlArena::SwitchHeapBack(previous);
+	User::LeaveIfError(error);
+	}
+
+/** Prepares the UTF-8 value in the heap of the thread, see PrepareValue8L. */
+void CXmlElement::DoPrepareValue8L() const
+	{
+	if (iValue8.Length() == 0)
+		{
+		if (iValue && iValue->Length() > 0)
+			{
+			HBufC8 * buffer = ConversionUtils::ConvertToUtf8L(*iValue);
+			ResetValue8();
+			iValueBuffer8 = buffer;
+			iValue8.Set(*iValueBuffer8);
+			iValue8IsDecoded = ETrue;
+			}
+		}
+	else if (!iValue8IsDecoded)
+		{
+		if (iValue8.Locate(KCharAmpersand8()[0]) != KErrNotFound)
+			{
+			HBufC8 * buffer = iValue8.AllocL();
+			TPtr8 ptr(buffer->Des());
+			ConversionUtils::DecodeReferences(ptr);
+			ResetValue8();
+			iValueBuffer8 = buffer;
+			iValue8.Set(*iValueBuffer8);
+			}
+		iValue8IsDecoded = ETrue;
+		}
+	}
+
+/**
+ * Copies the values of the element and its descendants that are views, see
+ * SetValueViewL, to storage of their own, so that the elements stay valid
+ * after the memory viewed is freed.
+ */
+void CXmlElement::CopyValueViewsL()
+	{
+	if (!iValueBuffer8 && iValue8.Length() > 0)
+		{
+		iValueBuffer8 = iValue8.AllocL();
+		iValue8.Set(*iValueBuffer8);
+		}
+	const TInt count = iChildren.Count();
+	for (TInt counter = 0; counter < count; ++counter)
+		{
+		iChildren[counter]->CopyValueViewsL();
+		}
+	}
+
+/**
+ * Leaves with KErrNotSupported if the element was created in another heap
+ * than the current heap of the thread, e.g. in a CXmlArena. Its memory
+ * could not be reallocated or freed, see EXmlParseArena.
+ */
+void CXmlElement::CheckHeapL() const
+	{
+	if (iHeap != &User::Allocator())
+		{
+		User::Leave(KErrNotSupported);
+		}
+	}
+
+/** Forgets the UTF-8 value, freeing its storage if owned. */
+void CXmlElement::ResetValue8() const
+	{
+	delete iValueBuffer8;
+	iValueBuffer8 = 0;
+	iValue8.Set(KNullDesC8);
+	iValue8IsDecoded = EFalse;
+	}
+
+/**
+ * Removes the CDATA markers from the UTF-8 value, as Trim does from
+ * a 16 bit one. Markers around the whole value are removed by narrowing
+ * it, others by copying the value.
+ */
+void CXmlElement::TrimValue8L()
+	{
+	const TInt start = iValue8.Find(KCDataStart8);
+	const TInt end = iValue8.Find(KCDataEnd8);
+	if (start == KErrNotFound && end == KErrNotFound)
+		{
+		return;
+		}
+	if (start != KErrNotFound)
+		{
+		SetValueIsCData(ETrue);
+		}
+	const TInt startLength = KCDataStart8().Length();
+	if (start == 0 && end == iValue8.Length() - KCDataEnd8().Length() && end >= startLength)
+		{
+		iValue8.Set(iValue8.Mid(startLength, end - startLength));
+		return;
+		}
+	HBufC8 * buffer = iValue8.AllocL();
+	TPtr8 ptr(buffer->Des());
+	TInt offset = ptr.Find(KCDataStart8);
+	if (offset >= KErrNone)
+		{
+		ptr.Delete(offset, startLength);
+		}
+	offset = ptr.Find(KCDataEnd8);
+	if (offset >= KErrNone)
+		{
+		ptr.Delete(offset, KCDataEnd8().Length());
+		}
+	const TBool isDecoded = iValue8IsDecoded;
+	ResetValue8();
+	iValueBuffer8 = buffer;
+	iValue8.Set(*iValueBuffer8);
+	iValue8IsDecoded = isDecoded;
 	}
 
 /**
@@ -456,9 +864,46 @@ EXPORT_C const CXmlElement * CXmlElement::Child(TInt aChild) const
  */
 EXPORT_C void CXmlElement::AddElementL(const CXmlElement * aElement)
 	{
+	CheckHeapL();
+	if (aElement->iHeap != iHeap)
+		{
+		// The child would not be freed with the arena, or be deleted in the wrong heap.
+		User::Leave(KErrNotSupported);
+		}
 	iChildren.AppendL(aElement);
 	}
 
+/**
+ * Removes a child element from this XML element, without destroying it.
+ * The caller takes the ownership of the child, whose parent is set to 0.
+ * Panics if index is out of bounds, or if the element is in a CXmlArena.
+ * @param aChild Index to the child object.
+ * @returns The removed child XML element.
+ */
+EXPORT_C CXmlElement * CXmlElement::RemoveChild(TInt aChild)
+	{
+	// The caller could not delete a child allocated in an arena.
+	__ASSERT_ALWAYS(iHeap == &User::Allocator(), Panic(EArenaElement));
+	CXmlElement * child = iChildren[aChild];
+	iChildren.Remove(aChild);
+	child->SetParent(0);
+	return child;
+	}
+
+/**
+ * Checks if the element has a name, without widening a name set as 8 bit.
+ * @param aName The name.
+ * @returns ETrue if the element has the name.
+ */
+TBool CXmlElement::HasName(const TDesC & aName) const
+	{
+	if (iName || !iName8)
+		{
+		return aName == Name();
+		}
+	return EqualsNarrow(aName, *iName8);
+	}
+
 /**
  * Retrieves an XML element by name, const version.
  * If this element has the name, returns this, otherwise searches
@@ -469,7 +914,7 @@ EXPORT_C void CXmlElement::AddElementL(const CXmlElement * aElement)
  */
 EXPORT_C const CXmlElement * CXmlElement::Element(const TDesC & aNameSpace, const TDesC & aName) const
 	{
-	if (aNameSpace == iNameSpace && aName == *iName)
+	if (aNameSpace == iNameSpace && HasName(aName))
 		{
 		return this;
 		}
@@ -496,7 +941,7 @@ EXPORT_C const CXmlElement * CXmlElement::Element(const TDesC & aNameSpace, cons
  */
 EXPORT_C CXmlElement * CXmlElement::Element(const TDesC & aNameSpace, const TDesC & aName)
 	{
-	if (aNameSpace == iNameSpace && aName == *iName)
+	if (aNameSpace == iNameSpace && HasName(aName))
 		{
 		return this;
 		}
@@ -513,6 +958,64 @@ EXPORT_C CXmlElement * CXmlElement::Element(const TDesC & aNameSpace, const TDes
 	return 0;
 	}
 
+/**
+ * Retrieves an XML element by 8 bit name, const version. If the element
+ * names are interned in a pool, see SetNameL, they are compared by address.
+ * If this element has the name, returns this, otherwise searches
+ * for the child elements with the name.
+ * @param aNameSpace The namespace of the element to find.
+ * @param aName The element's name to find.
+ * @returns XML element, 0 if not found.
+ */
+EXPORT_C const CXmlElement * CXmlElement::Element(const TDesC8 & aNameSpace, const TDesC8 & aName) const
+	{
+	const HBufC8 * name = iPool ? iPool->Find(aName) : 0;
+	return FindElement(aNameSpace, aName, iPool, name);
+	}
+
+/**
+ * Retrieves an XML element by 8 bit name. If the element names are
+ * interned in a pool, see SetNameL, they are compared by address.
+ * If this element has the name, returns this, otherwise searches
+ * for the child elements with the name.
+ * @param aNameSpace The namespace of the element to find.
+ * @param aName The element's name to find.
+ * @returns XML element, 0 if not found.
+ */
+EXPORT_C CXmlElement * CXmlElement::Element(const TDesC8 & aNameSpace, const TDesC8 & aName)
+	{
+	const CXmlElement * self = this;
+	return const_cast<CXmlElement *>(self->Element(aNameSpace, aName));
+	}
+
+/**
+ * Searches this element and its children for a name. Names interned in
+ * the pool the name was looked up in are compared by address, others
+ * by content.
+ * @param aNameSpace The namespace of the element to find.
+ * @param aName The element's name to find.
+ * @param aPool The pool aName was looked up in, or 0.
+ * @param aPooledName The name in aPool, 0 if not there.
+ * @returns XML element, 0 if not found.
+ */
+const CXmlElement * CXmlElement::FindElement(const TDesC8 & aNameSpace, const TDesC8 & aName,
+		const CXmlStringPool * aPool, const HBufC8 * aPooledName) const
+	{
+	const TBool hasName = (aPool && iPool == aPool && iNameIsPooled)
+			? iName8 == aPooledName : Name8() == aName;
+	if (hasName && EqualsNarrow(iNameSpace, aNameSpace))
+		{
+		return this;
+		}
+	for (TInt counter = 0; counter < iChildren.Count(); counter++)
+		{
+		const CXmlElement * tmp = iChildren[counter]->FindElement(aNameSpace, aName, aPool, aPooledName);
+		if (tmp != 0)
+			return tmp;
+		}
+	return 0;
+	}
+
 /** 
  * Queries the count of attributes in the element.
  * @returns The count of attributes.
@@ -596,6 +1099,71 @@ EXPORT_C const CKeyValue * CXmlElement::Attribute(const TDesC & aNameSpace, cons
 	return 0;
 	}
 
+/**
+ * Get the specific attribute of the element by 8 bit name. If the keys
+ * are interned in a pool, they are compared by address.
+ * Returns 0 if no attribute can be found from this element
+ * or from the children of this element.
+ * @param aNameSpace The namespace of the attribute's key.
+ * @param aKey The attribute's key.
+ * @returns The attribute.
+ */
+EXPORT_C CKeyValue * CXmlElement::Attribute(const TDesC8 & aNameSpace, const TDesC8 & aKey)
+	{
+	const CXmlElement * self = this;
+	return const_cast<CKeyValue *>(self->Attribute(aNameSpace, aKey));
+	}
+
+/**
+ * Get the specific attribute of the element by 8 bit name, const version.
+ * If the keys are interned in a pool, they are compared by address.
+ * Returns 0 if no attribute can be found from this element
+ * or from the children of this element.
+ * @param aNameSpace The namespace of the attribute's key.
+ * @param aKey The attribute's key.
+ * @returns The attribute.
+ */
+EXPORT_C const CKeyValue * CXmlElement::Attribute(const TDesC8 & aNameSpace, const TDesC8 & aKey) const
+	{
+	const HBufC8 * nameSpace = 0;
+	const HBufC8 * key = 0;
+	if (iPool)
+		{
+		nameSpace = iPool->Find(aNameSpace);
+		key = iPool->Find(aKey);
+		}
+	return FindAttribute(aNameSpace, aKey, iPool, nameSpace, key);
+	}
+
+/**
+ * Searches the attributes of this element and its children.
+ * @see CKeyValue::Matches
+ * @param aNameSpace The namespace of the attribute's key.
+ * @param aKey The attribute's key.
+ * @param aPool The pool the names were looked up in, or 0.
+ * @param aPooledNameSpace The namespace in aPool, 0 if not there.
+ * @param aPooledKey The key in aPool, 0 if not there.
+ * @returns The attribute, 0 if not found.
+ */
+const CKeyValue * CXmlElement::FindAttribute(const TDesC8 & aNameSpace, const TDesC8 & aKey,
+		const CXmlStringPool * aPool, const HBufC8 * aPooledNameSpace, const HBufC8 * aPooledKey) const
+	{
+	TInt counter;
+	for (counter = 0; counter < iAttributes.Count(); counter++)
+		{
+		if (iAttributes[counter]->Matches(aNameSpace, aKey, aPool, aPooledNameSpace, aPooledKey))
+			return iAttributes[counter];
+		}
+	for (counter = 0; counter < iChildren.Count(); counter++)
+		{
+		const CKeyValue * tmp = iChildren[counter]->FindAttribute(aNameSpace, aKey,
+				aPool, aPooledNameSpace, aPooledKey);
+		if (tmp != 0)
+			return tmp;
+		}
+	return 0;
+	}
+
 /**
  * Retrieves the value of the attribute from this element, or from
  * the child elements' attributes if one is not found in this element.
@@ -628,6 +1196,11 @@ EXPORT_C const TDesC & CXmlElement::AttributeKeyValue(const TDesC & aNameSpace,
  */
 EXPORT_C void CXmlElement::AddAttributeL(CKeyValue * aKeyValue)
 	{
+	CheckHeapL();
+	if (aKeyValue->Heap() != iHeap)
+		{
+		User::Leave(KErrNotSupported);
+		}
 	iAttributes.AppendL(aKeyValue);
 	}
 
@@ -639,8 +1212,16 @@ EXPORT_C void CXmlElement::AddAttributeL(CKeyValue * aKeyValue)
  */
 EXPORT_C void CXmlElement::AddAttributesL(RKeyValuePairs & aKeyValues)
 	{
+	CheckHeapL();
 	TInt counter;
 	TInt count = aKeyValues.Count();
+	for (counter = 0; counter < count; counter++)
+		{
+		if (aKeyValues[counter]->Heap() != iHeap)
+			{
+			User::Leave(KErrNotSupported);
+			}
+		}
 	for (counter = 0; counter < count; counter++)
 		{
 		iAttributes.AppendL(aKeyValues[counter]);
@@ -686,11 +1267,15 @@ EXPORT_C TInt CXmlElement::ApproximateTextLength() const
 	{
 	TInt counter;
 	TInt length = (iNameSpace.Length() + 1) * 2;
-	length += iName->Length() * 2;
+	length += (iName8 ? iName8->Length() : Name().Length()) * 2;
 	if (iValue)
 		{
 		length += iValue->Length();
 		}
+	else
+		{
+		length += iValue8.Length();
+		}
 	if (ValueIsCData())
 		{
 		length += 12;
@@ -723,6 +1308,7 @@ EXPORT_C void CXmlElement::GetAsTextL(TDes8 & aBuffer)
 	TInt counter;
 	TInt count;
 	TBool done = EFalse;
+	PrepareValue8L();
 	
 	aBuffer.Append(KCharLessThan);  	// <
 	if (iNameSpace.Length() > 0)
@@ -730,7 +1316,7 @@ EXPORT_C void CXmlElement::GetAsTextL(TDes8 & aBuffer)
 		aBuffer.Append(iNameSpace);
 		aBuffer.Append(KCharColon);		// <atom:
 		}
-	aBuffer.Append(*iName);
+	aBuffer.Append(Name8());
 	count = iAttributes.Count();
 	if (count > 0)
 		{
@@ -745,7 +1331,7 @@ EXPORT_C void CXmlElement::GetAsTextL(TDes8 & aBuffer)
 			}
 		}
 	count = iChildren.Count();
-	if (count == 0 && !iValue)	// no children, no value
+	if (count == 0 && iValue8.Length() == 0)	// no children, no value
 		{
 		aBuffer.Append(KCharSpace); 		// <atom:element key="value"_
 		aBuffer.Append(KCharSlash); 		// <atom:element key="value" /
@@ -756,18 +1342,18 @@ EXPORT_C void CXmlElement::GetAsTextL(TDes8 & aBuffer)
 	if (!done)
 		{
 		aBuffer.Append(KCharGreaterThan); 		// <atom:element key="value">
-		if (iValue)  // ?? can there be both children and value ??
+		if (iValue8.Length() > 0)  // ?? can there be both children and value ??
 			{
 			// <atom:element key="value">This is the value here
 			if (ValueIsCData())
 				{
 				aBuffer.Append(KCDataStart8);
-				ConversionUtils::AppendToUtf8BufferL(*iValue, aBuffer);
+				aBuffer.Append(iValue8);
 				aBuffer.Append(KCDataEnd8);
 				}
 			else
 				{
-				ConversionUtils::AppendToUtf8BufferEncodedL(*iValue, aBuffer);
+				ConversionUtils::AppendToUtf8BufferEncodedL(iValue8, aBuffer);
 				}
 			}
 		if (count > 0)			// has childen
@@ -786,7 +1372,7 @@ EXPORT_C void CXmlElement::GetAsTextL(TDes8 & aBuffer)
 			aBuffer.Append(KCharColon);		// <atom:element key="value">This is value</atom:
 			}
 		// <atom:element key="value">This is value</atom:element
-		aBuffer.Append(*iName);
+		aBuffer.Append(Name8());
 		aBuffer.Append(KCharGreaterThan);	// <atom:element key="value">This is value</atom:element>
 		}
 	}
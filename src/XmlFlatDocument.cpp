@@ -0,0 +1,1104 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <xml\attribute.h>
+
+#include "XmlFlatDocument.h"
+#include "XMLDocument.h"
+#include "KeyValue.h"
+#include "XmlElement.h"
+#include "XmlStringPool.h"
+#include "XmlVisitor.h"
+#include "XMLParserConstants.h"
+#include "ConversionUtils.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Size the text of a document is first allocated in. */
+const TInt KXmlFlatMinTextSize = 256;
+
+/**
+ * Gives a pooled name as a descriptor.
+ * @param aName The name, 0 if none.
+ * @returns The name, empty if none.
+ */
+LOCAL_C const TDesC8 & NameOrNull(const HBufC8 * aName)
+	{
+	if (aName)
+		{
+		return *aName;
+		}
+	return KNullDesC8;
+	}
+
+/** Orders the names converted to 16 bit by the addresses of the pooled names. */
+LOCAL_C TInt CompareWideNames(const TXmlFlatWideName & aFirst, const TXmlFlatWideName & aSecond)
+	{
+	if (aFirst.iName == aSecond.iName)
+		{
+		return 0;
+		}
+	return (aFirst.iName < aSecond.iName) ? -1 : 1;
+	}
+
+// TXmlFlatElement
+
+/**
+ * Constructor.
+ * @param aDocument The document of the element.
+ * @param aIndex Index of the element in the document, KErrNotFound for null.
+ */
+EXPORT_C TXmlFlatElement::TXmlFlatElement(const CXmlFlatDocument & aDocument, TInt aIndex)
+: iDocument(&aDocument), iIndex(aIndex)
+	{
+	}
+
+/**
+ * Checks if the element is null, returned when no element is found.
+ * The other queries must not be used for a null element.
+ * @returns ETrue, if the element is null.
+ */
+EXPORT_C TBool TXmlFlatElement::IsNull() const
+	{
+	return iIndex == KErrNotFound;
+	}
+
+/**
+ * Gives the index of the element in the document.
+ * @returns The index, KErrNotFound if the element is null.
+ */
+EXPORT_C TInt TXmlFlatElement::Index() const
+	{
+	return iIndex;
+	}
+
+/**
+ * Query the namespace prefix of the element, converted to 16 bit on
+ * the first query. If there is no memory for it, the namespace is
+ * empty until a later query succeeds.
+ * @returns The namespace, empty if none.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::NameSpace() const
+	{
+	return iDocument->WideName(Node().iNameSpace);
+	}
+
+/**
+ * Query the name of the element, converted to 16 bit on the first
+ * query. If there is no memory for it, the name is empty until
+ * a later query succeeds.
+ * @returns The name.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::Name() const
+	{
+	return iDocument->WideName(Node().iName);
+	}
+
+/**
+ * Query the value of the element, converted to 16 bit on the first
+ * query. If there is no memory for it, the value is empty until
+ * a later query succeeds.
+ * @returns The value, with the references decoded.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::Value() const
+	{
+	const TXmlFlatNode & node = Node();
+	return iDocument->WideText(node.iWideValue, node.iValueOffset, node.iValueLength);
+	}
+
+/**
+ * Query the namespace prefix of the element.
+ * @returns The namespace, empty if none.
+ */
+EXPORT_C const TDesC8 & TXmlFlatElement::NameSpace8() const
+	{
+	return NameOrNull(Node().iNameSpace);
+	}
+
+/**
+ * Query the name of the element.
+ * @returns The name.
+ */
+EXPORT_C const TDesC8 & TXmlFlatElement::Name8() const
+	{
+	return NameOrNull(Node().iName);
+	}
+
+/**
+ * Query the value of the element.
+ * @returns The value as UTF-8, with the references decoded.
+ */
+EXPORT_C TPtrC8 TXmlFlatElement::Value8() const
+	{
+	const TXmlFlatNode & node = Node();
+	return iDocument->Text(node.iValueOffset, node.iValueLength);
+	}
+
+/**
+ * Query if the value of the element is CDATA.
+ * @returns ETrue, if the value is CDATA.
+ */
+EXPORT_C TBool TXmlFlatElement::ValueIsCData() const
+	{
+	return Node().iValueIsCData;
+	}
+
+/**
+ * Child count of the element.
+ * @returns The count of children.
+ */
+EXPORT_C TInt TXmlFlatElement::ChildCount() const
+	{
+	return Node().iChildCount;
+	}
+
+/**
+ * Gets a child of the element. The children are found by following
+ * the siblings from the first child, so iterate them with the siblings
+ * when there are many.
+ * @param aChild Index of the child.
+ * @returns The child, null if there is no such child.
+ */
+EXPORT_C TXmlFlatElement TXmlFlatElement::Child(TInt aChild) const
+	{
+	if (aChild < 0 || aChild >= Node().iChildCount)
+		{
+		return TXmlFlatElement(*iDocument, KErrNotFound);
+		}
+	TInt index = iIndex + 1;
+	for (; aChild > 0; --aChild)
+		{
+		index = iDocument->Node(index).iNextSibling;
+		}
+	return TXmlFlatElement(*iDocument, index);
+	}
+
+/**
+ * Gets the parent of the element.
+ * @returns The parent, null for a topmost element.
+ */
+EXPORT_C TXmlFlatElement TXmlFlatElement::Parent() const
+	{
+	return TXmlFlatElement(*iDocument, Node().iParent);
+	}
+
+/**
+ * Retrieves an XML element by name. If this element has the name,
+ * returns this, otherwise the first descendant with the name.
+ * @param aNameSpace The namespace of the element to find.
+ * @param aName The element's name to find.
+ * @returns The element, null if not found.
+ */
+EXPORT_C TXmlFlatElement TXmlFlatElement::Element(const TDesC8 & aNameSpace, const TDesC8 & aName) const
+	{
+	return TXmlFlatElement(*iDocument, iDocument->Find(aNameSpace, aName, iIndex, Node().iEnd));
+	}
+
+/**
+ * Queries the count of attributes in the element.
+ * @returns The count of attributes.
+ */
+EXPORT_C TInt TXmlFlatElement::AttributeCount() const
+	{
+	return Node().iAttributeCount;
+	}
+
+/**
+ * Query the namespace of an attribute as 16 bit, see NameSpace().
+ * The index must be less than AttributeCount().
+ * @param aIndex The attribute index.
+ * @returns The namespace, empty if none.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::AttributeNameSpace(TInt aIndex) const
+	{
+	return iDocument->WideName(iDocument->Attribute(Node().iFirstAttribute + aIndex).iNameSpace);
+	}
+
+/**
+ * Query the key of an attribute as 16 bit, see Name().
+ * The index must be less than AttributeCount().
+ * @param aIndex The attribute index.
+ * @returns The key.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::AttributeKey(TInt aIndex) const
+	{
+	return iDocument->WideName(iDocument->Attribute(Node().iFirstAttribute + aIndex).iKey);
+	}
+
+/**
+ * Query the value of an attribute as 16 bit, see Value().
+ * The index must be less than AttributeCount().
+ * @param aIndex The attribute index.
+ * @returns The value.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::AttributeValue(TInt aIndex) const
+	{
+	const TXmlFlatAttribute & attribute = iDocument->Attribute(Node().iFirstAttribute + aIndex);
+	return iDocument->WideText(attribute.iWideValue, attribute.iValueOffset, attribute.iValueLength);
+	}
+
+/**
+ * Retrieves the value of the attribute from this element, or from the
+ * descendants' attributes if one is not found in this element, as
+ * CXmlElement::AttributeKeyValue.
+ * @param aNameSpace The namespace of the attribute's key.
+ * @param aKey The key to be searched.
+ * @returns The value of the attribute, empty if not found.
+ */
+EXPORT_C const TDesC & TXmlFlatElement::AttributeKeyValue(const TDesC & aNameSpace, const TDesC & aKey) const
+	{
+	const TInt end = AttributeEnd();
+	for (TInt index = Node().iFirstAttribute; index < end; ++index)
+		{
+		const TXmlFlatAttribute & attribute = iDocument->Attribute(index);
+		if (iDocument->WideName(attribute.iKey) == aKey
+				&& iDocument->WideName(attribute.iNameSpace) == aNameSpace)
+			{
+			return iDocument->WideText(attribute.iWideValue, attribute.iValueOffset, attribute.iValueLength);
+			}
+		}
+	return KNullDesC;
+	}
+
+/**
+ * Query the namespace of an attribute. The index must be less than AttributeCount().
+ * @param aIndex The attribute index.
+ * @returns The namespace, empty if none.
+ */
+EXPORT_C const TDesC8 & TXmlFlatElement::AttributeNameSpace8(TInt aIndex) const
+	{
+	return NameOrNull(iDocument->Attribute(Node().iFirstAttribute + aIndex).iNameSpace);
+	}
+
+/**
+ * Query the key of an attribute. The index must be less than AttributeCount().
+ * @param aIndex The attribute index.
+ * @returns The key.
+ */
+EXPORT_C const TDesC8 & TXmlFlatElement::AttributeKey8(TInt aIndex) const
+	{
+	return NameOrNull(iDocument->Attribute(Node().iFirstAttribute + aIndex).iKey);
+	}
+
+/**
+ * Query the value of an attribute. The index must be less than AttributeCount().
+ * @param aIndex The attribute index.
+ * @returns The value as UTF-8.
+ */
+EXPORT_C TPtrC8 TXmlFlatElement::AttributeValue8(TInt aIndex) const
+	{
+	const TXmlFlatAttribute & attribute = iDocument->Attribute(Node().iFirstAttribute + aIndex);
+	return iDocument->Text(attribute.iValueOffset, attribute.iValueLength);
+	}
+
+/**
+ * Retrieves the value of the attribute from this element, or from
+ * the descendants' attributes if one is not found in this element.
+ * @param aNameSpace The namespace of the attribute's key.
+ * @param aKey The key to be searched.
+ * @returns The value of the attribute, empty if not found.
+ */
+EXPORT_C TPtrC8 TXmlFlatElement::AttributeKeyValue8(const TDesC8 & aNameSpace, const TDesC8 & aKey) const
+	{
+	const TInt end = AttributeEnd();
+	for (TInt index = Node().iFirstAttribute; index < end; ++index)
+		{
+		const TXmlFlatAttribute & attribute = iDocument->Attribute(index);
+		if (NameOrNull(attribute.iKey) == aKey && NameOrNull(attribute.iNameSpace) == aNameSpace)
+			{
+			return iDocument->Text(attribute.iValueOffset, attribute.iValueLength);
+			}
+		}
+	return TPtrC8();
+	}
+
+/**
+ * Copies the element and its descendants to a CXmlElement tree, for code
+ * written for CXmlElement. The copy is independent of the document.
+ * @returns The copy, left in the cleanup stack.
+ */
+EXPORT_C CXmlElement * TXmlFlatElement::CopyLC() const
+	{
+	CXmlElement * element = CXmlElement::NewLC(NameSpace8(), Name8(), KNullDesC8);
+	const TXmlFlatNode & node = Node();
+	if (node.iValueLength > 0)
+		{
+		// Set as 16 bit, as the 8 bit setters would decode the references again.
+		HBufC * value = ConversionUtils::ConvertToUnicodeL(Value8());
+		CleanupStack::PushL(value);
+		element->SetValueL(*value);
+		CleanupStack::PopAndDestroy(value);
+		}
+	element->SetValueIsCData(node.iValueIsCData);
+	TInt counter;
+	for (counter = 0; counter < node.iAttributeCount; ++counter)
+		{
+		CKeyValue * attribute = CKeyValue::NewLC(AttributeNameSpace8(counter),
+				AttributeKey8(counter), AttributeValue8(counter));
+		element->AddAttributeL(attribute);
+		CleanupStack::Pop(attribute);
+		}
+	TInt index = (node.iChildCount > 0) ? iIndex + 1 : KErrNotFound;
+	while (index != KErrNotFound)
+		{
+		CXmlElement * child = TXmlFlatElement(*iDocument, index).CopyLC();
+		element->AddElementL(child);
+		CleanupStack::Pop(child);
+		child->SetParent(element);
+		index = iDocument->Node(index).iNextSibling;
+		}
+	return element;
+	}
+
+/** Gives the node of the element. */
+const TXmlFlatNode & TXmlFlatElement::Node() const
+	{
+	return iDocument->Node(iIndex);
+	}
+
+/**
+ * Gives the index after the attributes of the element and its descendants.
+ * They follow the ones of the element, up to the attributes of the
+ * element after them.
+ * @returns The index of the attribute after them.
+ */
+TInt TXmlFlatElement::AttributeEnd() const
+	{
+	const TXmlFlatNode & node = Node();
+	return (node.iEnd < iDocument->Count())
+			? iDocument->Node(node.iEnd).iFirstAttribute
+			: iDocument->AttributeCount();
+	}
+
+// CXmlFlatDocument
+
+/**
+ * Creates an empty document.
+ * @returns The document.
+ */
+EXPORT_C CXmlFlatDocument * CXmlFlatDocument::NewL()
+	{
+	CXmlFlatDocument * self = CXmlFlatDocument::NewLC();
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/**
+ * Creates an empty document, left in the cleanup stack.
+ * @returns The document.
+ */
+EXPORT_C CXmlFlatDocument * CXmlFlatDocument::NewLC()
+	{
+	CXmlFlatDocument * self = new (ELeave) CXmlFlatDocument;
+	CleanupStack::PushL(self);
+	self->ConstructL();
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlFlatDocument::CXmlFlatDocument()
+: iCurrent(KErrNotFound), iLastChild(KErrNotFound)
+	{
+	}
+
+/** 2nd phase constructor, creates the name pool. */
+void CXmlFlatDocument::ConstructL()
+	{
+	iNames = CXmlStringPool::NewL();
+	}
+
+/** Destructor, releases the arrays, the text and the names. */
+EXPORT_C CXmlFlatDocument::~CXmlFlatDocument()
+	{
+	ResetWideValues();
+	const TInt count = iWideNames.Count();
+	for (TInt index = 0; index < count; ++index)
+		{
+		delete iWideNames[index].iWideName;
+		}
+	iWideNames.Close();
+	iNodes.Close();
+	iAttributes.Close();
+	iText.Close();
+	if (iNames)
+		{
+		iNames->Close();
+		}
+	}
+
+/**
+ * Appends an element and its descendants to the document. If an element
+ * is being parsed into the document, the element is added as its child,
+ * otherwise as a topmost element. The element is not changed or taken.
+ * @param aElement The element to append.
+ */
+EXPORT_C void CXmlFlatDocument::AppendL(const CXmlElement & aElement)
+	{
+	AppendTreeL(aElement);
+	}
+
+/**
+ * Appends the elements of a DOM document, see AppendL(const CXmlElement &).
+ * @param aDocument The document to append.
+ */
+EXPORT_C void CXmlFlatDocument::AppendL(const CXmlDocument & aDocument)
+	{
+	const RXmlElementArray & elements = aDocument.Elements();
+	const TInt count = elements.Count();
+	for (TInt counter = 0; counter < count; ++counter)
+		{
+		AppendTreeL(*elements[counter]);
+		}
+	}
+
+/**
+ * Removes all the elements. The memory is kept for the next document,
+ * as are the names, which are likely to appear in it again.
+ */
+EXPORT_C void CXmlFlatDocument::Reset()
+	{
+	ResetWideValues();
+	iNodes.Reset();
+	iAttributes.Reset();
+	iText.Zero();
+	iCurrent = KErrNotFound;
+	iLastChild = KErrNotFound;
+	iPendingNameSpaces = 0;
+	}
+
+/**
+ * Count of the elements in the document, all of them, not just the topmost.
+ * @returns The count of elements.
+ */
+EXPORT_C TInt CXmlFlatDocument::Count() const
+	{
+	return iNodes.Count();
+	}
+
+/**
+ * Gets an element by its index in document order.
+ * @param aIndex The index, less than Count().
+ * @returns The element.
+ */
+EXPORT_C TXmlFlatElement CXmlFlatDocument::Element(TInt aIndex) const
+	{
+	return TXmlFlatElement(*this, aIndex);
+	}
+
+/**
+ * Retrieves the first XML element in the document with the name.
+ * @param aNameSpace The namespace of the element to find.
+ * @param aName The element's name to find.
+ * @returns The element, null if not found.
+ */
+EXPORT_C TXmlFlatElement CXmlFlatDocument::Element(const TDesC8 & aNameSpace, const TDesC8 & aName) const
+	{
+	return TXmlFlatElement(*this, Find(aNameSpace, aName, 0, iNodes.Count()));
+	}
+
+/**
+ * Finds an element with the name from a range of elements. The names are
+ * looked up from the pool once, and the elements are then compared by the
+ * pooled names only.
+ * @param aNameSpace The namespace of the element to find.
+ * @param aName The element's name to find.
+ * @param aFrom Index of the first element to search.
+ * @param aEnd Index after the last element to search.
+ * @returns The index of the element, KErrNotFound if not found.
+ */
+EXPORT_C TInt CXmlFlatDocument::Find(const TDesC8 & aNameSpace, const TDesC8 & aName, TInt aFrom, TInt aEnd) const
+	{
+	const HBufC8 * name = iNames->Find(aName);
+	const HBufC8 * nameSpace = 0;
+	if (aNameSpace.Length() > 0)
+		{
+		nameSpace = iNames->Find(aNameSpace);
+		if (!nameSpace)
+			{
+			return KErrNotFound;
+			}
+		}
+	if (!name)
+		{
+		return KErrNotFound;
+		}
+	const TInt end = Min(aEnd, iNodes.Count());
+	for (TInt index = Max(aFrom, 0); index < end; ++index)
+		{
+		const TXmlFlatNode & node = iNodes[index];
+		if (node.iName == name && node.iNameSpace == nameSpace)
+			{
+			return index;
+			}
+		}
+	return KErrNotFound;
+	}
+
+/**
+ * Accepts a visitor, which visits the elements in document order.
+ * @param aVisitor The visitor.
+ */
+EXPORT_C void CXmlFlatDocument::AcceptL(MXmlFlatVisitor & aVisitor) const
+	{
+	const TInt count = iNodes.Count();
+	for (TInt index = 0; index < count; ++index)
+		{
+		aVisitor.VisitL(TXmlFlatElement(*this, index));
+		}
+	}
+
+/**
+ * Accepts a visitor written for CXmlDocument and CXmlElement. Each topmost
+ * element is copied to a CXmlElement tree in turn, see
+ * TXmlFlatElement::CopyLC, which accepts the visitor and is then destroyed,
+ * so only one tree is in memory at a time. There is no CXmlDocument to
+ * visit, so the visitor visits the elements and attributes only.
+ * @param aVisitor The visitor.
+ */
+EXPORT_C void CXmlFlatDocument::AcceptL(MXmlVisitor & aVisitor) const
+	{
+	TInt index = (iNodes.Count() > 0) ? 0 : KErrNotFound;
+	while (index != KErrNotFound)
+		{
+		CXmlElement * element = TXmlFlatElement(*this, index).CopyLC();
+		element->AcceptL(aVisitor);
+		CleanupStack::PopAndDestroy(element);
+		index = iNodes[index].iNextSibling;
+		}
+	}
+
+/**
+ * Calculates the approximate length of the document as XML text,
+ * see CXmlElement::ApproximateTextLength. Values with many characters
+ * to encode may take more.
+ * @returns The approximate length of the text.
+ */
+EXPORT_C TInt CXmlFlatDocument::ApproximateTextLength() const
+	{
+	TInt length = 0;
+	TInt counter;
+	for (counter = iNodes.Count() - 1; counter >= 0; --counter)
+		{
+		const TXmlFlatNode & node = iNodes[counter];
+		length += (NameOrNull(node.iNameSpace).Length() + 1) * 2;
+		length += NameOrNull(node.iName).Length() * 2;
+		length += node.iValueLength;
+		if (node.iValueIsCData)
+			{
+			length += 12;
+			}
+		length += 11; // <, >, /, the separator
+		}
+	for (counter = iAttributes.Count() - 1; counter >= 0; --counter)
+		{
+		const TXmlFlatAttribute & attribute = iAttributes[counter];
+		length += NameOrNull(attribute.iNameSpace).Length() + NameOrNull(attribute.iKey).Length();
+		length += attribute.iValueLength + 5; // :, =, the quotes, the separator
+		}
+	return length;
+	}
+
+/**
+ * Exports the elements of the document as text to a 8 bit descriptor,
+ * in the format of CXmlElement::GetAsTextL. There must be enough room
+ * in the buffer to hold the data, else panics.
+ * @param aBuffer The buffer to hold the data.
+ */
+EXPORT_C void CXmlFlatDocument::GetAsTextL(TDes8 & aBuffer) const
+	{
+	// The descendants of an element follow it, so an element is closed
+	// before the first element which is not its descendant, found from
+	// the innermost open element up.
+	TInt open = KErrNotFound;
+	const TInt count = iNodes.Count();
+	for (TInt index = 0; index < count; ++index)
+		{
+		while (open != KErrNotFound && iNodes[open].iEnd <= index)
+			{
+			AppendEndTag(open, aBuffer);
+			open = iNodes[open].iParent;
+			}
+		AppendStartTagL(index, aBuffer);
+		if (iNodes[index].iChildCount > 0 || iNodes[index].iValueLength > 0)
+			{
+			open = index;
+			}
+		}
+	while (open != KErrNotFound)
+		{
+		AppendEndTag(open, aBuffer);
+		open = iNodes[open].iParent;
+		}
+	}
+
+/**
+ * Exports the document into a 8 bit descriptor, with the XML header,
+ * left in the cleanup stack.
+ * @returns Dynamically allocated descriptor holding the XML as text.
+ */
+EXPORT_C HBufC8 * CXmlFlatDocument::ExportToUtf8LC() const
+	{
+	HBufC8 * buf = HBufC8::NewLC(KXMLHeaderWithUTF8Encoding().Length() + ApproximateTextLength() * 2);
+	TPtr8 ptr(buf->Des());
+	ptr.Append(KXMLHeaderWithUTF8Encoding);
+	GetAsTextL(ptr);
+	return buf;
+	}
+
+/**
+ * Gives an element of the document.
+ * @param aIndex The index of the element.
+ * @returns The element.
+ */
+const TXmlFlatNode & CXmlFlatDocument::Node(TInt aIndex) const
+	{
+	return iNodes[aIndex];
+	}
+
+/**
+ * Gives an attribute of the document.
+ * @param aIndex The index of the attribute.
+ * @returns The attribute.
+ */
+const TXmlFlatAttribute & CXmlFlatDocument::Attribute(TInt aIndex) const
+	{
+	return iAttributes[aIndex];
+	}
+
+/**
+ * Count of the attributes in the document.
+ * @returns The count of attributes.
+ */
+TInt CXmlFlatDocument::AttributeCount() const
+	{
+	return iAttributes.Count();
+	}
+
+/**
+ * Gives a piece of the text of the document.
+ * @param aOffset Offset of the piece.
+ * @param aLength Length of the piece.
+ * @returns The text.
+ */
+TPtrC8 CXmlFlatDocument::Text(TInt aOffset, TInt aLength) const
+	{
+	return iText.Mid(aOffset, aLength);
+	}
+
+/**
+ * Gives a pooled name as 16 bit. Each name is converted once, and
+ * kept as long as the document.
+ * @param aName The pooled name, 0 if none.
+ * @returns The name, empty if none or if there is no memory for it.
+ */
+const TDesC & CXmlFlatDocument::WideName(const HBufC8 * aName) const
+	{
+	if (!aName)
+		{
+		return KNullDesC;
+		}
+	TXmlFlatWideName name;
+	name.iName = aName;
+	name.iWideName = 0;
+	TLinearOrder<TXmlFlatWideName> order(CompareWideNames);
+	TInt index;
+	if (iWideNames.FindInOrder(name, index, order) == KErrNone)
+		{
+		return *iWideNames[index].iWideName;
+		}
+	TRAPD(error, name.iWideName = ConversionUtils::ConvertToUnicodeL(*aName));
+	if (error != KErrNone)
+		{
+		return KNullDesC;
+		}
+	if (iWideNames.Insert(name, index) != KErrNone)
+		{
+		delete name.iWideName;
+		return KNullDesC;
+		}
+	return *name.iWideName;
+	}
+
+/**
+ * Gives a value as 16 bit, converting it if not converted already.
+ * @param aWideText The converted value of the element or attribute.
+ * @param aOffset Offset of the value in the text.
+ * @param aLength Length of the value.
+ * @returns The value, empty if there is no memory for it.
+ */
+const TDesC & CXmlFlatDocument::WideText(HBufC *& aWideText, TInt aOffset, TInt aLength) const
+	{
+	if (!aWideText && aLength > 0)
+		{
+		TRAP_IGNORE(aWideText = ConversionUtils::ConvertToUnicodeL(Text(aOffset, aLength)));
+		}
+	if (aWideText)
+		{
+		return *aWideText;
+		}
+	return KNullDesC;
+	}
+
+/** Releases the values converted to 16 bit. */
+void CXmlFlatDocument::ResetWideValues()
+	{
+	TInt index;
+	for (index = iNodes.Count() - 1; index >= 0; --index)
+		{
+		delete iNodes[index].iWideValue;
+		iNodes[index].iWideValue = 0;
+		}
+	for (index = iAttributes.Count() - 1; index >= 0; --index)
+		{
+		delete iAttributes[index].iWideValue;
+		iAttributes[index].iWideValue = 0;
+		}
+	}
+
+/**
+ * See MXmlSaxHandler. Adds the element with its attributes, and
+ * the namespace declarations preceding it as its attributes.
+ */
+void CXmlFlatDocument::StartElementL(const TDesC8 & /*aUri*/, const TDesC8 & aPrefix,
+		const TDesC8 & aLocalName, const Xml::RAttributeArray & aAttributes)
+	{
+	const TInt index = StartNodeL(aPrefix, aLocalName);
+	const TInt count = aAttributes.Count();
+	for (TInt counter = 0; counter < count; ++counter)
+		{
+		const Xml::RAttribute & attribute = aAttributes[counter];
+		AddAttributeL(attribute.Attribute().Prefix().DesC(),
+				attribute.Attribute().LocalName().DesC(), attribute.Value().DesC());
+		++iNodes[index].iAttributeCount;
+		}
+	}
+
+/** See MXmlSaxHandler. Ends the element being built. */
+void CXmlFlatDocument::EndElementL(const TDesC8 & /*aUri*/, const TDesC8 & /*aPrefix*/,
+		const TDesC8 & /*aLocalName*/)
+	{
+	if (iCurrent != KErrNotFound)
+		{
+		EndNode(iCurrent);
+		}
+	}
+
+/**
+ * See MXmlSaxHandler. Adds the content to the value of the element being
+ * built, decoding the references as CXmlElement::AddToValueL.
+ */
+void CXmlFlatDocument::ContentL(const TDesC8 & aBytes)
+	{
+	if (iCurrent == KErrNotFound || aBytes.Length() == 0)
+		{
+		return;
+		}
+	// The value changes, so it is converted again if queried.
+	delete iNodes[iCurrent].iWideValue;
+	iNodes[iCurrent].iWideValue = 0;
+	if (iNodes[iCurrent].iValueLength == 0)
+		{
+		iNodes[iCurrent].iValueOffset = iText.Length();
+		}
+	else if (iNodes[iCurrent].iValueOffset + iNodes[iCurrent].iValueLength != iText.Length())
+		{
+		// Content after a child element, the value is moved to the end of
+		// the text to be continued there.
+		ReserveTextL(iNodes[iCurrent].iValueLength + aBytes.Length());
+		const TInt offset = iText.Length();
+		iText.Append(iText.Mid(iNodes[iCurrent].iValueOffset, iNodes[iCurrent].iValueLength));
+		iNodes[iCurrent].iValueOffset = offset;
+		}
+	const TInt start = AppendTextL(aBytes);
+	TPtr8 addition(iText.MidTPtr(start));
+	ConversionUtils::DecodeReferences(addition);
+	iText.SetLength(start + addition.Length());
+	iNodes[iCurrent].iValueLength = iText.Length() - iNodes[iCurrent].iValueOffset;
+	}
+
+/**
+ * See MXmlSaxHandler. The declaration is added as an attribute of the
+ * next element, as CXmlParser adds it to the topmost element.
+ */
+void CXmlFlatDocument::StartPrefixMappingL(const TDesC8 & aPrefix, const TDesC8 & aUri)
+	{
+	AddAttributeL(KXmlNs, aPrefix, aUri);
+	++iPendingNameSpaces;
+	}
+
+/** See MXmlSaxHandler. Nothing to do. */
+void CXmlFlatDocument::EndPrefixMappingL(const TDesC8 & /*aPrefix*/)
+	{
+	}
+
+/**
+ * Adds an element after the last one, as a child of the element being
+ * built, and makes it the element being built.
+ * @param aNameSpace The namespace prefix of the element.
+ * @param aName The name of the element.
+ * @returns The index of the element.
+ */
+TInt CXmlFlatDocument::StartNodeL(const TDesC8 & aNameSpace, const TDesC8 & aName)
+	{
+	TXmlFlatNode node;
+	node.iNameSpace = (aNameSpace.Length() > 0) ? iNames->InternL(aNameSpace) : 0;
+	node.iName = iNames->InternL(aName);
+	node.iParent = iCurrent;
+	node.iNextSibling = KErrNotFound;
+	const TInt index = iNodes.Count();
+	node.iEnd = index + 1; // Until the element has been ended.
+	node.iChildCount = 0;
+	node.iFirstAttribute = iAttributes.Count() - iPendingNameSpaces;
+	node.iAttributeCount = iPendingNameSpaces;
+	node.iValueOffset = 0;
+	node.iValueLength = 0;
+	node.iValueIsCData = EFalse;
+	node.iWideValue = 0;
+	iNodes.AppendL(node);
+	iPendingNameSpaces = 0;
+	if (iLastChild != KErrNotFound)
+		{
+		iNodes[iLastChild].iNextSibling = index;
+		}
+	if (iCurrent != KErrNotFound)
+		{
+		++iNodes[iCurrent].iChildCount;
+		}
+	iCurrent = index;
+	iLastChild = KErrNotFound;
+	return index;
+	}
+
+/**
+ * Ends an element, its descendants are then known. The parent of the
+ * element becomes the element being built.
+ * @param aIndex The index of the element, the one being built.
+ */
+void CXmlFlatDocument::EndNode(TInt aIndex)
+	{
+	TXmlFlatNode & node = iNodes[aIndex];
+	delete node.iWideValue;
+	node.iWideValue = 0;
+	TrimValue(node);
+	node.iEnd = iNodes.Count();
+	iLastChild = aIndex;
+	iCurrent = node.iParent;
+	}
+
+/**
+ * Adds an attribute after the last one. The caller counts it
+ * to the element it belongs to.
+ * @param aNameSpace The namespace prefix of the attribute.
+ * @param aKey The key of the attribute.
+ * @param aValue The value of the attribute.
+ */
+void CXmlFlatDocument::AddAttributeL(const TDesC8 & aNameSpace, const TDesC8 & aKey, const TDesC8 & aValue)
+	{
+	TXmlFlatAttribute attribute;
+	attribute.iNameSpace = (aNameSpace.Length() > 0) ? iNames->InternL(aNameSpace) : 0;
+	attribute.iKey = (aKey.Length() > 0) ? iNames->InternL(aKey) : 0;
+	attribute.iValueOffset = AppendTextL(aValue);
+	attribute.iValueLength = aValue.Length();
+	attribute.iWideValue = 0;
+	iAttributes.AppendL(attribute);
+	}
+
+/**
+ * Appends an element and its descendants, recursively. The values
+ * of the element have been decoded already.
+ * @param aElement The element.
+ */
+void CXmlFlatDocument::AppendTreeL(const CXmlElement & aElement)
+	{
+	TBuf8<KMaxXmlNameSpaceLength> nameSpace;
+	nameSpace.Copy(aElement.NameSpace().Left(KMaxXmlNameSpaceLength));
+	const TInt index = StartNodeL(nameSpace, aElement.Name8());
+	TInt counter;
+	const TInt attributes = aElement.AttributeCount();
+	for (counter = 0; counter < attributes; ++counter)
+		{
+		const CKeyValue * attribute = aElement.Attribute(counter);
+		AddAttributeL(attribute->NameSpace8(), attribute->Key8(), attribute->Value8());
+		++iNodes[index].iAttributeCount;
+		}
+	const TDesC8 & value = aElement.Value8();
+	iNodes[index].iValueOffset = AppendTextL(value);
+	iNodes[index].iValueLength = value.Length();
+	iNodes[index].iValueIsCData = aElement.ValueIsCData();
+	const TInt children = aElement.ChildCount();
+	for (counter = 0; counter < children; ++counter)
+		{
+		AppendTreeL(*aElement.Child(counter));
+		}
+	iNodes[index].iEnd = iNodes.Count();
+	iLastChild = index;
+	iCurrent = iNodes[index].iParent;
+	}
+
+/**
+ * Appends a piece to the text of the document.
+ * @param aText The piece.
+ * @returns The offset of the piece in the text.
+ */
+TInt CXmlFlatDocument::AppendTextL(const TDesC8 & aText)
+	{
+	ReserveTextL(aText.Length());
+	const TInt offset = iText.Length();
+	iText.Append(aText);
+	return offset;
+	}
+
+/**
+ * Makes room for more text. The buffer grows at least by doubling, so
+ * the text is copied a few times however many pieces are appended.
+ * @param aLength The length to make room for.
+ */
+void CXmlFlatDocument::ReserveTextL(TInt aLength)
+	{
+	const TInt required = iText.Length() + aLength;
+	if (required > iText.MaxLength())
+		{
+		iText.ReAllocL(Max(Max(required, iText.MaxLength() * 2), KXmlFlatMinTextSize));
+		}
+	}
+
+/**
+ * Removes the CDATA markers from the value of an element in place,
+ * as CXmlElement::TrimValue8L, and marks the value as CDATA.
+ * @param aNode The element.
+ */
+void CXmlFlatDocument::TrimValue(TXmlFlatNode & aNode)
+	{
+	if (aNode.iValueLength == 0)
+		{
+		return;
+		}
+	const TBool atEnd = (aNode.iValueOffset + aNode.iValueLength == iText.Length());
+	TPtr8 value(iText.MidTPtr(aNode.iValueOffset, aNode.iValueLength));
+	TInt offset = value.Find(KCDataStart8);
+	if (offset != KErrNotFound)
+		{
+		aNode.iValueIsCData = ETrue;
+		value.Delete(offset, KCDataStart8().Length());
+		offset = value.Find(KCDataEnd8);
+		if (offset != KErrNotFound)
+			{
+			value.Delete(offset, KCDataEnd8().Length());
+			}
+		aNode.iValueLength = value.Length();
+		if (atEnd)
+			{
+			iText.SetLength(aNode.iValueOffset + aNode.iValueLength);
+			}
+		}
+	}
+
+/**
+ * Appends the start tag of an element, and its value, to a buffer.
+ * The tag is closed if the element has neither children nor value.
+ * @param aIndex The index of the element.
+ * @param aBuffer The buffer.
+ */
+void CXmlFlatDocument::AppendStartTagL(TInt aIndex, TDes8 & aBuffer) const
+	{
+	const TXmlFlatNode & node = iNodes[aIndex];
+	aBuffer.Append(KCharLessThan);
+	if (node.iNameSpace)
+		{
+		aBuffer.Append(*node.iNameSpace);
+		aBuffer.Append(KCharColon);
+		}
+	aBuffer.Append(NameOrNull(node.iName));
+	const TInt end = node.iFirstAttribute + node.iAttributeCount;
+	for (TInt counter = node.iFirstAttribute; counter < end; ++counter)
+		{
+		const TXmlFlatAttribute & attribute = iAttributes[counter];
+		aBuffer.Append(KCharSpace);
+		if (attribute.iNameSpace)
+			{
+			aBuffer.Append(*attribute.iNameSpace);
+			}
+		if (attribute.iKey)
+			{
+			if (attribute.iNameSpace)
+				{
+				aBuffer.Append(KCharColon);
+				}
+			aBuffer.Append(*attribute.iKey);
+			}
+		aBuffer.Append(KCharEquals);
+		aBuffer.Append(KCharQuote);
+		ConversionUtils::AppendToUtf8BufferEncodedL(
+				Text(attribute.iValueOffset, attribute.iValueLength), aBuffer);
+		aBuffer.Append(KCharQuote);
+		}
+	if (node.iChildCount == 0 && node.iValueLength == 0)
+		{
+		aBuffer.Append(KCharSpace);
+		aBuffer.Append(KCharSlash);
+		aBuffer.Append(KCharGreaterThan);
+		return;
+		}
+	aBuffer.Append(KCharGreaterThan);
+	if (node.iValueLength > 0)
+		{
+		const TPtrC8 value(Text(node.iValueOffset, node.iValueLength));
+		if (node.iValueIsCData)
+			{
+			aBuffer.Append(KCDataStart8);
+			aBuffer.Append(value);
+			aBuffer.Append(KCDataEnd8);
+			}
+		else
+			{
+			ConversionUtils::AppendToUtf8BufferEncodedL(value, aBuffer);
+			}
+		}
+	}
+
+/**
+ * Appends the end tag of an element to a buffer.
+ * @param aIndex The index of the element.
+ * @param aBuffer The buffer.
+ */
+void CXmlFlatDocument::AppendEndTag(TInt aIndex, TDes8 & aBuffer) const
+	{
+	const TXmlFlatNode & node = iNodes[aIndex];
+	aBuffer.Append(KCharLessThan);
+	aBuffer.Append(KCharSlash);
+	if (node.iNameSpace)
+		{
+		aBuffer.Append(*node.iNameSpace);
+		aBuffer.Append(KCharColon);
+		}
+	aBuffer.Append(NameOrNull(node.iName));
+	aBuffer.Append(KCharGreaterThan);
+	}
+
+} // ajj
+} // org
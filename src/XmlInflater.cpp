@@ -0,0 +1,554 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include "XmlInflater.h"
+#include "XMLParser.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Gzip header flag: extra field present. */
+const TUint8 KGzipFlagExtra = 0x04;
+/** Gzip header flag: original file name present. */
+const TUint8 KGzipFlagName = 0x08;
+/** Gzip header flag: comment present. */
+const TUint8 KGzipFlagComment = 0x10;
+/** Gzip header flag: header CRC present. */
+const TUint8 KGzipFlagHeaderCrc = 0x02;
+/** Length of the fixed part of the gzip header. */
+const TInt KGzipHeaderLength = 10;
+
+/** Signature of a zip local file header. */
+const TUint32 KZipLocalHeaderSignature = 0x04034b50;
+/** Signature of a zip central directory file header. */
+const TUint32 KZipCentralHeaderSignature = 0x02014b50;
+/** Signature of the end of the zip central directory. */
+const TUint32 KZipEndSignature = 0x06054b50;
+/** Length of the fixed part of the zip local file header. */
+const TInt KZipLocalHeaderLength = 30;
+/** Zip general purpose flag: the member is encrypted. */
+const TUint KZipFlagEncrypted = 0x0001;
+/** Zip general purpose flag: sizes follow the data in a data descriptor. */
+const TUint KZipFlagDataDescriptor = 0x0008;
+/** Zip compression method: stored. */
+const TUint KZipMethodStored = 0;
+/** Zip compression method: deflated. */
+const TUint KZipMethodDeflated = 8;
+
+/** Longest header gathered before giving up on the input. */
+const TInt KMaxHeaderLength = 0x20000;
+
+_LIT8(KKmlExtension, ".kml");
+_LIT8(KXmlExtension, ".xml");
+
+/** Reads a little endian 16 bit value from a descriptor. */
+LOCAL_C TUint ReadUint16(const TDesC8 & aData, TInt aOffset)
+	{
+	return aData[aOffset] | (aData[aOffset + 1] << 8);
+	}
+
+/** Reads a little endian 32 bit value from a descriptor. */
+LOCAL_C TUint32 ReadUint32(const TDesC8 & aData, TInt aOffset)
+	{
+	return ReadUint16(aData, aOffset) | (ReadUint16(aData, aOffset + 2) << 16);
+	}
+
+/**
+ * Creates a new inflater feeding the given parser.
+ * @param aParser The parser the decompressed XML is fed to.
+ * @param aCompression The format of the compressed input.
+ * @param aWindowSize Size of the window the data is inflated into.
+ * @returns The inflater object.
+ */
+EXPORT_C CXmlInflater * CXmlInflater::NewL(CXmlParser & aParser,
+		TXmlCompression aCompression, TInt aWindowSize)
+	{
+	CXmlInflater * self = CXmlInflater::NewLC(aParser, aCompression, aWindowSize);
+	CleanupStack::Pop(); // self
+	return self;
+	}
+
+/**
+ * Creates a new inflater feeding the given parser, leaves it on the cleanup stack.
+ * @param aParser The parser the decompressed XML is fed to.
+ * @param aCompression The format of the compressed input.
+ * @param aWindowSize Size of the window the data is inflated into.
+ * @returns The inflater object.
+ */
+EXPORT_C CXmlInflater * CXmlInflater::NewLC(CXmlParser & aParser,
+		TXmlCompression aCompression, TInt aWindowSize)
+	{
+	CXmlInflater * self = new (ELeave) CXmlInflater(aParser, aCompression);
+	CleanupStack::PushL(self);
+	self->ConstructL(aWindowSize);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlInflater::CXmlInflater(CXmlParser & aParser, TXmlCompression aCompression)
+: iParser(aParser), iRequestedCompression(aCompression), iCompression(aCompression)
+	{
+	}
+
+/** 2nd phase constructor, allocates the window.
+ * @param aWindowSize Size of the window the data is inflated into.
+ */
+void CXmlInflater::ConstructL(TInt aWindowSize)
+	{
+	iWindow = HBufC8::NewL(Max(aWindowSize, 1));
+	Reset();
+	}
+
+/** Destructor, releases the zlib stream and the buffers. */
+EXPORT_C CXmlInflater::~CXmlInflater()
+	{
+	EndInflate();
+	delete iWindow;
+	iHeader.Close();
+	}
+
+/**
+ * Resets the inflater for a new compressed document. FinishL
+ * and InflateFileL do this when the document ends.
+ */
+EXPORT_C void CXmlInflater::Reset()
+	{
+	EndInflate();
+	iHeader.Close();
+	iCompression = iRequestedCompression;
+	iState = iCompression == EXmlCompressionNone ? EPassThrough : EHeader;
+	iRemaining = 0;
+	}
+
+/**
+ * Decompresses a piece of the compressed document and feeds the
+ * decompressed XML to the parser. The piece can be of any size and split
+ * anywhere, also within the headers.
+ * Leaves with KErrCorrupt if the data is not in the expected format,
+ * and with KErrNotSupported for zip members that cannot be streamed.
+ * @param aCompressed The next piece of the compressed document.
+ */
+EXPORT_C void CXmlInflater::InflateL(const TDesC8 & aCompressed)
+	{
+	ProcessL(aCompressed);
+	}
+
+/**
+ * Ends the compressed document and the parsing of it, see CXmlParser::FinishL.
+ * @returns KErrNone if all went well, KErrCorrupt if the compressed
+ * document was truncated, otherwise the error from the parser.
+ */
+EXPORT_C TInt CXmlInflater::FinishL()
+	{
+	TInt result = KErrNone;
+	if (iState == EHeader && iCompression == EXmlCompressionAuto)
+		{
+		// Fewer bytes than the detection needs: plain XML, or the start
+		// of a compressed header that was cut short.
+		DetectCompression(ETrue);
+		if (iCompression != EXmlCompressionNone)
+			{
+			result = KErrCorrupt;
+			}
+		else if (iHeader.Length() > 0)
+			{
+			iParser.FeedL(iHeader);
+			}
+		}
+	else if (iState == EHeader || iState == EInflate || iState == EStored || iState == ESkip)
+		{
+		result = KErrCorrupt;
+		}
+	TInt parserResult = iParser.FinishL();
+	Reset();
+	return result != KErrNone ? result : parserResult;
+	}
+
+/**
+ * Parses a compressed file, synchronously. The file is read in pieces
+ * of the window size, and each piece is decompressed and parsed before
+ * the next one is read.
+ * @param aFs File server session to use.
+ * @param aFileName The compressed file.
+ * @returns KErrNone if all went well, see FinishL.
+ */
+EXPORT_C TInt CXmlInflater::InflateFileL(RFs & aFs, const TDesC & aFileName)
+	{
+	RFile file;
+	User::LeaveIfError(file.Open(aFs, aFileName, EFileRead | EFileShareReadersOnly));
+	CleanupClosePushL(file);
+	HBufC8 * buffer = HBufC8::NewLC(iWindow->Des().MaxLength());
+	TPtr8 ptr(buffer->Des());
+	Reset();
+	do
+		{
+		User::LeaveIfError(file.Read(ptr));
+		ProcessL(ptr);
+		} while (ptr.Length() > 0);
+	CleanupStack::PopAndDestroy(2); // buffer, file
+	return FinishL();
+	}
+
+/**
+ * Runs the input through the state machine until all of it has been used.
+ * @param aInput The compressed input.
+ */
+void CXmlInflater::ProcessL(const TDesC8 & aInput)
+	{
+	TPtrC8 input(aInput);
+	while (input.Length() > 0)
+		{
+		const TState state = iState;
+		TInt used = input.Length();
+		switch (iState)
+			{
+			case EHeader:
+				used = ConsumeHeaderL(input);
+				break;
+			case EInflate:
+				used = InflateChunkL(input);
+				break;
+			case EStored:
+				used = Min(input.Length(), static_cast<TInt>(iRemaining));
+				iParser.FeedL(input.Left(used));
+				iRemaining -= used;
+				if (iRemaining == 0)
+					{
+					iState = EDone;
+					}
+				break;
+			case ESkip:
+				used = Min(input.Length(), static_cast<TInt>(iRemaining));
+				iRemaining -= used;
+				if (iRemaining == 0)
+					{
+					iState = EHeader;
+					}
+				break;
+			case EPassThrough:
+				iParser.FeedL(input);
+				break;
+			case EDone:
+			default:
+				// Trailers and the rest of an archive are ignored.
+				break;
+			}
+		if (used == 0 && state == iState)
+			{
+			// No progress, the data cannot be right.
+			User::Leave(KErrCorrupt);
+			}
+		input.Set(input.Mid(used));
+		}
+	}
+
+/**
+ * Gathers the header bytes until the header is complete, then starts
+ * processing the data following the header.
+ * @param aInput The input.
+ * @returns The count of bytes used, all of aInput.
+ */
+TInt CXmlInflater::ConsumeHeaderL(const TDesC8 & aInput)
+	{
+	// Headers are short, so they are gathered whole before parsing them.
+	if (iHeader.Length() + aInput.Length() > iHeader.MaxLength())
+		{
+		iHeader.ReAllocL(iHeader.Length() + aInput.Length());
+		}
+	iHeader.Append(aInput);
+	if (iCompression == EXmlCompressionAuto && !DetectCompression(EFalse))
+		{
+		return aInput.Length();
+		}
+
+	TInt headerLength = KErrNotFound;
+	switch (iCompression)
+		{
+		case EXmlCompressionGzip:
+			headerLength = GzipHeaderLengthL();
+			if (headerLength >= 0)
+				{
+				StartInflateL(-MAX_WBITS);
+				}
+			break;
+		case EXmlCompressionZip:
+			headerLength = ZipHeaderLengthL();
+			break;
+		case EXmlCompressionZlib:
+			headerLength = 0;
+			StartInflateL(MAX_WBITS);
+			break;
+		case EXmlCompressionDeflate:
+			headerLength = 0;
+			StartInflateL(-MAX_WBITS);
+			break;
+		default:
+			headerLength = 0;
+			iState = EPassThrough;
+			break;
+		}
+	if (headerLength < 0)
+		{
+		if (iHeader.Length() > KMaxHeaderLength)
+			{
+			User::Leave(KErrCorrupt);
+			}
+		return aInput.Length();
+		}
+	// The header is complete, process the rest of the gathered bytes.
+	HBufC8 * rest = iHeader.Mid(headerLength).AllocLC();
+	iHeader.Zero();
+	ProcessL(*rest);
+	CleanupStack::PopAndDestroy(rest);
+	return aInput.Length();
+	}
+
+/**
+ * Detects the compression format from the first bytes gathered in iHeader.
+ * @param aAtEnd ETrue if no more input is coming.
+ * @returns ETrue if the format was detected, EFalse if more bytes are needed.
+ */
+TBool CXmlInflater::DetectCompression(TBool aAtEnd)
+	{
+	const TDesC8 & h = iHeader;
+	if (h.Length() < 4 && !aAtEnd)
+		{
+		return EFalse;
+		}
+	if (h.Length() >= 2 && h[0] == 0x1f && h[1] == 0x8b)
+		{
+		iCompression = EXmlCompressionGzip;
+		}
+	else if (h.Length() >= 4 && ReadUint32(h, 0) == KZipLocalHeaderSignature)
+		{
+		iCompression = EXmlCompressionZip;
+		}
+	else if (h.Length() >= 2 && (h[0] & 0x0f) == 8 && (h[0] >> 4) <= 7
+			&& ((h[0] << 8) | h[1]) % 31 == 0)
+		{
+		iCompression = EXmlCompressionZlib;
+		}
+	else
+		{
+		iCompression = EXmlCompressionNone;
+		}
+	return ETrue;
+	}
+
+/**
+ * Parses the gzip header gathered in iHeader.
+ * @returns The length of the header, KErrNotFound if it is not complete yet.
+ */
+TInt CXmlInflater::GzipHeaderLengthL() const
+	{
+	const TDesC8 & h = iHeader;
+	if (h.Length() < KGzipHeaderLength)
+		{
+		return KErrNotFound;
+		}
+	if (h[0] != 0x1f || h[1] != 0x8b || h[2] != KZipMethodDeflated)
+		{
+		User::Leave(KErrCorrupt);
+		}
+	const TUint8 flags = h[3];
+	TInt pos = KGzipHeaderLength;
+	if (flags & KGzipFlagExtra)
+		{
+		if (h.Length() < pos + 2)
+			{
+			return KErrNotFound;
+			}
+		pos += 2 + ReadUint16(h, pos);
+		}
+	if (flags & KGzipFlagName)
+		{
+		TInt end = pos < h.Length() ? h.Mid(pos).Locate(0) : KErrNotFound;
+		if (end < 0)
+			{
+			return KErrNotFound;
+			}
+		pos += end + 1;
+		}
+	if (flags & KGzipFlagComment)
+		{
+		TInt end = pos < h.Length() ? h.Mid(pos).Locate(0) : KErrNotFound;
+		if (end < 0)
+			{
+			return KErrNotFound;
+			}
+		pos += end + 1;
+		}
+	if (flags & KGzipFlagHeaderCrc)
+		{
+		pos += 2;
+		}
+	return pos <= h.Length() ? pos : KErrNotFound;
+	}
+
+/**
+ * Parses the zip local file header gathered in iHeader, and sets the state
+ * to process the member. The first member named .kml or .xml is parsed,
+ * members before it are skipped.
+ * @returns The length of the header, KErrNotFound if it is not complete yet.
+ */
+TInt CXmlInflater::ZipHeaderLengthL()
+	{
+	const TDesC8 & h = iHeader;
+	if (h.Length() < 4)
+		{
+		return KErrNotFound;
+		}
+	const TUint32 signature = ReadUint32(h, 0);
+	if (signature == KZipCentralHeaderSignature || signature == KZipEndSignature)
+		{
+		// All members have been passed, and none of them was XML.
+		User::Leave(KErrNotFound);
+		}
+	if (signature != KZipLocalHeaderSignature)
+		{
+		User::Leave(KErrCorrupt);
+		}
+	if (h.Length() < KZipLocalHeaderLength)
+		{
+		return KErrNotFound;
+		}
+	const TUint flags = ReadUint16(h, 6);
+	const TUint method = ReadUint16(h, 8);
+	const TUint32 compressedSize = ReadUint32(h, 18);
+	const TUint32 size = ReadUint32(h, 22);
+	const TInt nameLength = ReadUint16(h, 26);
+	const TInt headerLength = KZipLocalHeaderLength + nameLength + ReadUint16(h, 28);
+	if (h.Length() < headerLength)
+		{
+		return KErrNotFound;
+		}
+
+	TPtrC8 name(h.Mid(KZipLocalHeaderLength, nameLength));
+	const TBool isXml = name.Length() >= KKmlExtension().Length()
+		&& (name.Right(KKmlExtension().Length()).CompareF(KKmlExtension) == 0
+			|| name.Right(KXmlExtension().Length()).CompareF(KXmlExtension) == 0);
+	if (isXml)
+		{
+		if (flags & KZipFlagEncrypted)
+			{
+			User::Leave(KErrNotSupported);
+			}
+		if (method == KZipMethodDeflated)
+			{
+			StartInflateL(-MAX_WBITS);
+			}
+		else if (method == KZipMethodStored && !(flags & KZipFlagDataDescriptor))
+			{
+			iRemaining = size;
+			iState = size > 0 ? EStored : EDone;
+			}
+		else
+			{
+			User::Leave(KErrNotSupported);
+			}
+		}
+	else
+		{
+		// Without the sizes in the header, the end of the member
+		// cannot be found without the central directory.
+		if (flags & KZipFlagDataDescriptor)
+			{
+			User::Leave(KErrNotSupported);
+			}
+		iRemaining = compressedSize;
+		iState = ESkip;
+		}
+	return headerLength;
+	}
+
+/**
+ * Initialises the zlib stream for inflating.
+ * @param aWindowBits Window bits for zlib, negative for raw deflate data.
+ */
+void CXmlInflater::StartInflateL(TInt aWindowBits)
+	{
+	EndInflate();
+	Mem::FillZ(&iStream, sizeof(iStream));
+	TInt err = inflateInit2(&iStream, aWindowBits);
+	if (err != Z_OK)
+		{
+		User::Leave(err == Z_MEM_ERROR ? KErrNoMemory : KErrGeneral);
+		}
+	iStreamOpen = ETrue;
+	iState = EInflate;
+	}
+
+/**
+ * Inflates input into the window, feeding the parser each time the window
+ * fills up and when the input has been used.
+ * @param aInput The deflate data.
+ * @returns The count of bytes used.
+ */
+TInt CXmlInflater::InflateChunkL(const TDesC8 & aInput)
+	{
+	TUint8 * window = const_cast<TUint8 *>(iWindow->Ptr());
+	const TInt windowSize = iWindow->Des().MaxLength();
+	iStream.next_in = const_cast<Bytef *>(aInput.Ptr());
+	iStream.avail_in = aInput.Length();
+	TInt result = Z_OK;
+	do
+		{
+		iStream.next_out = window;
+		iStream.avail_out = windowSize;
+		result = inflate(&iStream, Z_NO_FLUSH);
+		if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+			{
+			User::Leave(result == Z_MEM_ERROR ? KErrNoMemory : KErrCorrupt);
+			}
+		const TInt produced = windowSize - iStream.avail_out;
+		if (produced > 0)
+			{
+			iParser.FeedL(TPtrC8(window, produced));
+			}
+		} while (result == Z_OK && (iStream.avail_out == 0 || iStream.avail_in > 0));
+
+	const TInt used = aInput.Length() - iStream.avail_in;
+	if (result == Z_STREAM_END)
+		{
+		EndInflate();
+		iState = EDone;
+		}
+	return used;
+	}
+
+/** Releases the zlib stream, if it is in use. */
+void CXmlInflater::EndInflate()
+	{
+	if (iStreamOpen)
+		{
+		inflateEnd(&iStream);
+		iStreamOpen = EFalse;
+		}
+	}
+
+} // ajj
+} // org
@@ -0,0 +1,717 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include <ecom/ecom.h>
+#include "XmlParallelParser.h"
+#include "XMLParserConstants.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Stack size of the worker threads. */
+const TInt KXmlWorkerStackSize = 0x4000;
+
+/**
+ * A piece of a document split by CXmlParallelParser, and the elements
+ * parsed from it. Parsed in a worker thread, or in the calling thread.
+ */
+class CXmlPiece : public CBase, private MXmlParserObserver
+	{
+public:
+	CXmlPiece(HBufC8 * aXml, TXmlTokenizer aTokenizer);
+	~CXmlPiece();
+	void ParseL();
+	void StartThreadL();
+	void WaitForThread();
+	TInt Error() const;
+	RXmlElementArray & Elements();
+
+private:
+	static TInt ThreadFunction(TAny * aPiece);
+	static void ThreadMainL(CXmlPiece & aPiece);
+	// From MXmlParserObserver
+	virtual void FragmentParsedL();
+	virtual void ParsingFinishedL(TInt aError);
+
+private:
+	/** The XML of the piece, owned. */
+	HBufC8 * iXml;
+	/** The tokenizer to parse the piece with. */
+	const TXmlTokenizer iTokenizer;
+	/** The elements parsed from the piece, owned until moved away. */
+	RXmlElementArray iElements;
+	/** The result of parsing the piece. */
+	TInt iError;
+	/** The worker thread parsing the piece. */
+	RThread iThread;
+	/** Completed when the worker thread exits. */
+	TRequestStatus iExitStatus;
+	/** ETrue while the worker thread has not been waited for. */
+	TBool iThreadRunning;
+	};
+
+/** Constructor, takes the ownership of the XML. */
+CXmlPiece::CXmlPiece(HBufC8 * aXml, TXmlTokenizer aTokenizer)
+: iXml(aXml), iTokenizer(aTokenizer)
+	{
+	}
+
+/** Destructor, waits for the worker thread, which uses the piece. */
+CXmlPiece::~CXmlPiece()
+	{
+	WaitForThread();
+	iElements.ResetAndDestroy();
+	delete iXml;
+	}
+
+/** Parses the piece in the current thread, synchronously. */
+void CXmlPiece::ParseL()
+	{
+	CXmlParser * parser = CXmlParser::NewL(*this, iTokenizer);
+	CleanupStack::PushL(parser);
+	const TInt error = parser->ParseXmlBufferSyncL(*iXml);
+	if (iError == KErrNone)
+		{
+		iError = error;
+		}
+	parser->GetElementsL(iElements);
+	CleanupStack::PopAndDestroy(parser);
+	}
+
+/**
+ * Starts parsing the piece in a worker thread. The thread uses the heap
+ * of the calling thread, so the elements it creates can be moved to the
+ * document and destroyed by the client.
+ */
+void CXmlPiece::StartThreadL()
+	{
+	User::LeaveIfError(iThread.Create(KNullDesC, CXmlPiece::ThreadFunction,
+			KXmlWorkerStackSize, &User::Allocator(), this));
+	iThread.Logon(iExitStatus);
+	if (iExitStatus.Int() != KRequestPending)
+		{
+		// The exit could not be waited for, so the thread must not run.
+		iThread.Kill(KErrNone);
+		iThread.Close();
+		User::Leave(iExitStatus.Int());
+		}
+	iThreadRunning = ETrue;
+	iThread.Resume();
+	}
+
+/** Waits for the worker thread to exit, if it was started. */
+void CXmlPiece::WaitForThread()
+	{
+	if (iThreadRunning)
+		{
+		User::WaitForRequest(iExitStatus);
+		iThreadRunning = EFalse;
+		if (iThread.ExitType() != EExitKill)
+			{
+			iError = KErrDied;
+			}
+		else if (iError == KErrNone)
+			{
+			iError = iExitStatus.Int();
+			}
+		iThread.Close();
+		}
+	}
+
+/**
+ * Query the result of parsing the piece.
+ * @returns KErrNone if the piece was parsed.
+ */
+TInt CXmlPiece::Error() const
+	{
+	return iError;
+	}
+
+/**
+ * Gives the elements parsed from the piece.
+ * @returns The elements, still owned by the piece.
+ */
+RXmlElementArray & CXmlPiece::Elements()
+	{
+	return iElements;
+	}
+
+/**
+ * The function the worker threads start in.
+ * @param aPiece The piece to parse.
+ * @returns KErrNone, or the error the parsing left with.
+ */
+TInt CXmlPiece::ThreadFunction(TAny * aPiece)
+	{
+	CTrapCleanup * cleanup = CTrapCleanup::New();
+	if (!cleanup)
+		{
+		return KErrNoMemory;
+		}
+	TRAPD(error, ThreadMainL(*static_cast<CXmlPiece *>(aPiece)));
+	// The platform tokenizer is an ECom plugin, whose session is per thread.
+	REComSession::FinalClose();
+	delete cleanup;
+	return error;
+	}
+
+/**
+ * Installs an active scheduler for the parser of the worker thread, and parses the piece.
+ * @param aPiece The piece to parse.
+ */
+void CXmlPiece::ThreadMainL(CXmlPiece & aPiece)
+	{
+	CActiveScheduler * scheduler = new (ELeave) CActiveScheduler;
+	CleanupStack::PushL(scheduler);
+	CActiveScheduler::Install(scheduler);
+	aPiece.ParseL();
+	CleanupStack::PopAndDestroy(scheduler);
+	}
+
+/** See MXmlParserObserver. The elements are taken when the parsing has ended. */
+void CXmlPiece::FragmentParsedL()
+	{
+	}
+
+/** See MXmlParserObserver. */
+void CXmlPiece::ParsingFinishedL(TInt aError)
+	{
+	if (aError != KErrNone)
+		{
+		iError = aError;
+		}
+	}
+
+/** Kinds of markup found when splitting a document. */
+enum TXmlMarkup
+	{
+	EXmlStartTag,
+	EXmlEndTag,
+	EXmlEmptyElementTag,
+	/** Comment, CDATA section, processing instruction or DOCTYPE. */
+	EXmlOtherMarkup,
+	/** The document ends before the next complete markup. */
+	EXmlNoMarkup
+	};
+
+/**
+ * Finds the end of a construct ending with a delimiter.
+ * @param aXml The document.
+ * @param aFrom Where to start looking for the delimiter.
+ * @param aEnd The delimiter.
+ * @returns Offset of the byte after the delimiter, KErrNotFound if not found.
+ */
+LOCAL_C TInt FindEnd(const TDesC8 & aXml, TInt aFrom, const TDesC8 & aEnd)
+	{
+	if (aFrom > aXml.Length())
+		{
+		return KErrNotFound;
+		}
+	const TInt offset = aXml.Mid(aFrom).Find(aEnd);
+	return offset == KErrNotFound ? KErrNotFound : aFrom + offset + aEnd.Length();
+	}
+
+/**
+ * Finds the next markup of a document, skipping the text before it.
+ * Only the structure is looked at, the markup is not validated.
+ * @param aXml The document.
+ * @param aPos Where to start, set to the byte after the markup.
+ * @param aStart Set to the offset of the '<' of the markup.
+ * @returns The kind of the markup.
+ */
+LOCAL_C TXmlMarkup NextMarkup(const TDesC8 & aXml, TInt & aPos, TInt & aStart)
+	{
+	const TInt offset = aXml.Mid(aPos).Locate('<');
+	if (offset == KErrNotFound || aPos + offset + 1 >= aXml.Length())
+		{
+		return EXmlNoMarkup;
+		}
+	aStart = aPos + offset;
+	TXmlMarkup kind = EXmlOtherMarkup;
+	TInt end = KErrNotFound;
+	const TPtrC8 markup(aXml.Mid(aStart));
+	if (markup.Left(KCommentStart8().Length()) == KCommentStart8)
+		{
+		end = FindEnd(markup, KCommentStart8().Length(), KCommentEnd8);
+		}
+	else if (markup.Left(KCDataStart8().Length()) == KCDataStart8)
+		{
+		end = FindEnd(markup, KCDataStart8().Length(), KCDataEnd8);
+		}
+	else if (markup[1] == '?')
+		{
+		end = FindEnd(markup, 2, KProcessingInstructionEnd8);
+		}
+	else
+		{
+		// A tag, or a DOCTYPE, whose internal subset is in brackets.
+		TText8 quote = 0;
+		TInt brackets = 0;
+		for (TInt index = 1; index < markup.Length() && end == KErrNotFound; ++index)
+			{
+			const TText8 c = markup[index];
+			if (quote)
+				{
+				quote = (c == quote) ? 0 : quote;
+				}
+			else if (c == '"' || c == '\'')
+				{
+				quote = c;
+				}
+			else if (c == '[')
+				{
+				++brackets;
+				}
+			else if (c == ']')
+				{
+				--brackets;
+				}
+			else if (c == '>' && brackets == 0)
+				{
+				end = index + 1;
+				}
+			}
+		if (end != KErrNotFound && markup[1] != '!')
+			{
+			if (markup[1] == '/')
+				{
+				kind = EXmlEndTag;
+				}
+			else
+				{
+				kind = markup[end - 2] == '/' ? EXmlEmptyElementTag : EXmlStartTag;
+				}
+			}
+		}
+	if (end == KErrNotFound)
+		{
+		return EXmlNoMarkup;
+		}
+	aPos = aStart + end;
+	return kind;
+	}
+
+/**
+ * Gets the name of an element from its start tag.
+ * @param aXml The document.
+ * @param aStart Offset of the '<' of the start tag.
+ * @param aEnd Offset of the byte after the start tag.
+ * @returns The name.
+ */
+LOCAL_C TPtrC8 TagName(const TDesC8 & aXml, TInt aStart, TInt aEnd)
+	{
+	TInt end = aStart + 1;
+	while (end < aEnd)
+		{
+		const TText8 c = aXml[end];
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '/' || c == '>')
+			{
+			break;
+			}
+		++end;
+		}
+	return aXml.Mid(aStart + 1, end - aStart - 1);
+	}
+
+/**
+ * Appends children of an element to another one, without removing them.
+ * @param aSource The element the children are appended from.
+ * @param aFirst Index of the first child to append.
+ * @param aTarget The element the children are appended to.
+ * @param aAppended Counts the children appended.
+ */
+LOCAL_C void AppendChildrenL(const CXmlElement & aSource, TInt aFirst, CXmlElement & aTarget, TInt & aAppended)
+	{
+	const TInt count = aSource.ChildCount();
+	for (TInt index = aFirst; index < count; ++index)
+		{
+		aTarget.AddElementL(aSource.Child(index));
+		++aAppended;
+		}
+	}
+
+/**
+ * Moves children of an element to the end of the children of another one.
+ * @param aSource The element the children are moved from.
+ * @param aFirst Index of the first child to move, the rest are moved too.
+ * @param aTarget The element the children are moved to.
+ */
+LOCAL_C void MoveChildrenL(CXmlElement & aSource, TInt aFirst, CXmlElement & aTarget)
+	{
+	TInt appended = 0;
+	TRAPD(error, AppendChildrenL(aSource, aFirst, aTarget, appended));
+	if (error != KErrNone)
+		{
+		// The children appended are still owned by aSource.
+		while (appended-- > 0)
+			{
+			aTarget.RemoveChild(aTarget.ChildCount() - 1)->SetParent(&aSource);
+			}
+		User::Leave(error);
+		}
+	for (TInt index = aSource.ChildCount() - 1; index >= aFirst; --index)
+		{
+		aSource.RemoveChild(index)->SetParent(&aTarget);
+		}
+	}
+
+/**
+ * Creates a parallel parser.
+ * @param aTokenizer The tokenizer to parse the pieces with.
+ * @param aPieceCount How many pieces the document is split to, at most.
+ * @returns The parallel parser.
+ */
+CXmlParallelParser * CXmlParallelParser::NewLC(TXmlTokenizer aTokenizer, TInt aPieceCount)
+	{
+	CXmlParallelParser * self = new (ELeave) CXmlParallelParser(aTokenizer, aPieceCount);
+	CleanupStack::PushL(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlParallelParser::CXmlParallelParser(TXmlTokenizer aTokenizer, TInt aPieceCount)
+: iTokenizer(aTokenizer), iPieceCount(aPieceCount)
+	{
+	}
+
+/** Destructor, waits for the worker threads still running. */
+CXmlParallelParser::~CXmlParallelParser()
+	{
+	iPieces.ResetAndDestroy();
+	iChain.Close();
+	iCuts.Close();
+	}
+
+/**
+ * Splits the document to pieces, which are copied. Call once.
+ * @param aXml The document, may be destroyed when this method returns.
+ * @returns EFalse if no element with enough records to split was found.
+ */
+TBool CXmlParallelParser::SplitL(const TDesC8 & aXml)
+	{
+	if (iPieceCount < 2 || !FindContainerL(aXml) || !FindCutsL(aXml))
+		{
+		return EFalse;
+		}
+	CreatePiecesL(aXml);
+	return ETrue;
+	}
+
+/**
+ * Parses the pieces, and stitches them to one tree. The first piece is
+ * parsed in the calling thread while the worker threads parse the others.
+ * @param aElements The array where the elements of the document are appended.
+ * @returns KErrNone if all the pieces were parsed, otherwise the first error.
+ */
+TInt CXmlParallelParser::ParseL(RXmlElementArray & aElements)
+	{
+	const TInt count = iPieces.Count();
+	for (TInt index = 1; index < count; ++index)
+		{
+		iPieces[index]->StartThreadL();
+		}
+	iPieces[0]->ParseL();
+	TInt error = iPieces[0]->Error();
+	for (TInt index = 1; index < count; ++index)
+		{
+		iPieces[index]->WaitForThread();
+		if (error == KErrNone)
+			{
+			error = iPieces[index]->Error();
+			}
+		}
+	if (error != KErrNone)
+		{
+		return error;
+		}
+	RXmlElementArray & elements = iPieces[0]->Elements();
+	if (elements.Count() == 0)
+		{
+		return KErrCorrupt;
+		}
+	for (TInt index = 1; index < count; ++index)
+		{
+		RXmlElementArray & pieceElements = iPieces[index]->Elements();
+		if (pieceElements.Count() == 0)
+			{
+			return KErrCorrupt;
+			}
+		MergeL(*elements[0], *pieceElements[0], 0);
+		MergeNameSpacesL(*elements[0], *pieceElements[0]);
+		}
+	aElements.ReserveL(aElements.Count() + elements.Count());
+	for (TInt index = 0; index < elements.Count(); ++index)
+		{
+		aElements.AppendL(elements[index]);
+		}
+	elements.Reset();
+	return KErrNone;
+	}
+
+/**
+ * Finds the element the document is split in: the deepest one, down to
+ * KXmlMaxSplitDepth, containing most of the document and enough child
+ * elements for the pieces. The element and its ancestors are put to iChain.
+ * @param aXml The document.
+ * @returns EFalse if there is no such element.
+ */
+TBool CXmlParallelParser::FindContainerL(const TDesC8 & aXml)
+	{
+	RArray<TOpenTag> open;
+	CleanupClosePushL(open);
+	TInt depth = 0;
+	TInt pos = 0;
+	TInt start = 0;
+	TBool found = EFalse;
+	while (!found)
+		{
+		const TXmlMarkup markup = NextMarkup(aXml, pos, start);
+		if (markup == EXmlNoMarkup)
+			{
+			break;
+			}
+		if (markup == EXmlStartTag || markup == EXmlEmptyElementTag)
+			{
+			if (depth > 0 && depth <= open.Count())
+				{
+				open[depth - 1].iChildCount++;
+				}
+			if (markup == EXmlStartTag)
+				{
+				if (depth < KXmlMaxSplitDepth)
+					{
+					TOpenTag tag;
+					tag.iStart = start;
+					tag.iEnd = pos;
+					tag.iChildCount = 0;
+					open.AppendL(tag);
+					}
+				++depth;
+				}
+			}
+		else if (markup == EXmlEndTag)
+			{
+			if (depth == 0)
+				{
+				// Not well-formed, the tokenizer reports it.
+				break;
+				}
+			--depth;
+			if (depth < open.Count())
+				{
+				// Descendants end before their ancestors, so the first
+				// element found is the deepest one.
+				const TOpenTag & tag = open[depth];
+				if (tag.iChildCount >= 2 * iPieceCount && 2 * (start - tag.iEnd) >= aXml.Length())
+					{
+					for (TInt level = 0; level <= depth; ++level)
+						{
+						iChain.AppendL(open[level]);
+						}
+					iContainerEnd = start;
+					found = ETrue;
+					}
+				open.Remove(depth);
+				}
+			}
+		}
+	CleanupStack::PopAndDestroy(&open);
+	return found;
+	}
+
+/**
+ * Finds the offsets to cut the document at, after the child elements of
+ * the container ending closest after equal shares of its content.
+ * @param aXml The document.
+ * @returns EFalse if the document cannot be cut.
+ */
+TBool CXmlParallelParser::FindCutsL(const TDesC8 & aXml)
+	{
+	const TInt contentStart = iChain[iChain.Count() - 1].iEnd;
+	const TInt pieceLength = (iContainerEnd - contentStart) / iPieceCount;
+	const TPtrC8 content(aXml.Left(iContainerEnd));
+	TInt nextCut = contentStart + pieceLength;
+	TInt depth = 0;
+	TInt pos = contentStart;
+	TInt start = 0;
+	while (iCuts.Count() < iPieceCount - 1)
+		{
+		const TXmlMarkup markup = NextMarkup(content, pos, start);
+		if (markup == EXmlNoMarkup)
+			{
+			break;
+			}
+		if (markup == EXmlStartTag)
+			{
+			++depth;
+			}
+		else if (markup == EXmlEndTag)
+			{
+			--depth;
+			}
+		if (depth == 0 && (markup == EXmlEndTag || markup == EXmlEmptyElementTag) && pos >= nextCut)
+			{
+			iCuts.AppendL(pos);
+			nextCut = pos + pieceLength;
+			}
+		}
+	return iCuts.Count() > 0;
+	}
+
+/**
+ * Creates the pieces at the cuts.
+ * @param aXml The document.
+ */
+void CXmlParallelParser::CreatePiecesL(const TDesC8 & aXml)
+	{
+	iPieces.ReserveL(iCuts.Count() + 1);
+	TInt start = 0;
+	for (TInt index = 0; index <= iCuts.Count(); ++index)
+		{
+		const TInt end = (index < iCuts.Count()) ? iCuts[index] : aXml.Length();
+		HBufC8 * xml = CreatePieceLC(aXml, start, end);
+		CXmlPiece * piece = new (ELeave) CXmlPiece(xml, iTokenizer);
+		CleanupStack::Pop(xml);
+		iPieces.AppendL(piece); // Room was reserved, does not leave.
+		start = end;
+		}
+	}
+
+/**
+ * Creates a piece of the document, made a document of its own. Pieces
+ * after the first one begin with the prolog of the document, as it may
+ * declare the encoding or entities, and the start tags of the container
+ * and its ancestors. Pieces before the last one end with their end tags.
+ * @param aXml The document.
+ * @param aStart Offset of the piece, 0 for the first one.
+ * @param aEnd Offset of the end of the piece, the length of the document for the last one.
+ * @returns The piece.
+ */
+HBufC8 * CXmlParallelParser::CreatePieceLC(const TDesC8 & aXml, TInt aStart, TInt aEnd) const
+	{
+	const TPtrC8 prolog(aXml.Left(iChain[0].iStart));
+	const TInt levels = iChain.Count();
+	TInt length = aEnd - aStart;
+	if (aStart > 0)
+		{
+		length += prolog.Length();
+		for (TInt level = 0; level < levels; ++level)
+			{
+			length += iChain[level].iEnd - iChain[level].iStart;
+			}
+		}
+	if (aEnd < aXml.Length())
+		{
+		for (TInt level = 0; level < levels; ++level)
+			{
+			length += TagName(aXml, iChain[level].iStart, iChain[level].iEnd).Length()
+					+ KCharLessThan8().Length() + KCharSlash8().Length() + KCharGreaterThan8().Length();
+			}
+		}
+	HBufC8 * piece = HBufC8::NewLC(length);
+	TPtr8 ptr(piece->Des());
+	if (aStart > 0)
+		{
+		ptr.Append(prolog);
+		for (TInt level = 0; level < levels; ++level)
+			{
+			ptr.Append(aXml.Mid(iChain[level].iStart, iChain[level].iEnd - iChain[level].iStart));
+			}
+		}
+	ptr.Append(aXml.Mid(aStart, aEnd - aStart));
+	if (aEnd < aXml.Length())
+		{
+		for (TInt level = levels - 1; level >= 0; --level)
+			{
+			ptr.Append(KCharLessThan8);
+			ptr.Append(KCharSlash8);
+			ptr.Append(TagName(aXml, iChain[level].iStart, iChain[level].iEnd));
+			ptr.Append(KCharGreaterThan8);
+			}
+		}
+	return piece;
+	}
+
+/**
+ * Moves the elements parsed from a piece to the tree of the first piece.
+ * Above the container, the first child of an element of the piece is the
+ * copy of the next element in iChain, which continues the last child of
+ * the corresponding element of the tree. The children after it come from
+ * the end of the document, and are moved as they are.
+ * @param aTarget Element of the tree of the first piece.
+ * @param aSource The corresponding element of the piece.
+ * @param aLevel The level of the elements in iChain.
+ */
+void CXmlParallelParser::MergeL(CXmlElement & aTarget, CXmlElement & aSource, TInt aLevel) const
+	{
+	if (aLevel == iChain.Count() - 1)
+		{
+		MoveChildrenL(aSource, 0, aTarget);
+		return;
+		}
+	if (aTarget.ChildCount() == 0 || aSource.ChildCount() == 0)
+		{
+		User::Leave(KErrCorrupt);
+		}
+	MergeL(*aTarget.Child(aTarget.ChildCount() - 1), *aSource.Child(0), aLevel + 1);
+	MoveChildrenL(aSource, 1, aTarget);
+	}
+
+/**
+ * Copies the namespace definitions of the topmost element of a piece
+ * to the topmost element of the tree, if not defined there already.
+ * @param aTarget The topmost element of the tree.
+ * @param aSource The topmost element of a piece.
+ */
+void CXmlParallelParser::MergeNameSpacesL(CXmlElement & aTarget, const CXmlElement & aSource) const
+	{
+	const TInt count = aSource.AttributeCount();
+	for (TInt index = 0; index < count; ++index)
+		{
+		const CKeyValue * definition = aSource.Attribute(index);
+		if (definition->NameSpace() != KXmlNs16)
+			{
+			continue;
+			}
+		// Only the topmost element is searched, so not Attribute(aNameSpace, aKey).
+		TBool found = EFalse;
+		for (TInt existing = 0; existing < aTarget.AttributeCount() && !found; ++existing)
+			{
+			const CKeyValue * attribute = aTarget.Attribute(existing);
+			found = attribute->NameSpace() == definition->NameSpace() && attribute->Key() == definition->Key();
+			}
+		if (!found)
+			{
+			CKeyValue * copy = CKeyValue::NewLC(definition->NameSpace(), definition->Key(), definition->Value());
+			aTarget.AddAttributeL(copy);
+			CleanupStack::Pop(copy);
+			}
+		}
+	}
+
+} // ajj
+} // org
@@ -0,0 +1,145 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include "XmlParserPool.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/**
+ * Creates a new parser pool.
+ * @param aInitialCount The count of parsers to create in advance.
+ * @param aMaxIdleCount The most parsers kept when they are released.
+ * @param aTokenizer The tokenizer of the parsers, see CXmlParser::NewL.
+ * @returns The pool object.
+ */
+EXPORT_C CXmlParserPool * CXmlParserPool::NewL(TInt aInitialCount, TInt aMaxIdleCount,
+		TXmlTokenizer aTokenizer)
+	{
+	CXmlParserPool * self = new (ELeave) CXmlParserPool(aMaxIdleCount, aTokenizer);
+	CleanupStack::PushL(self);
+	self->ConstructL(aInitialCount);
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlParserPool::CXmlParserPool(TInt aMaxIdleCount, TXmlTokenizer aTokenizer)
+: iMaxIdleCount(Max(aMaxIdleCount, 0)), iTokenizer(aTokenizer)
+	{
+	}
+
+/** 2nd phase constructor, creates the parsers requested in advance.
+ * @param aInitialCount The count of parsers to create.
+ */
+void CXmlParserPool::ConstructL(TInt aInitialCount)
+	{
+	iIdleParsers.ReserveL(Max(aInitialCount, iMaxIdleCount));
+	for (TInt counter = 0; counter < aInitialCount; ++counter)
+		{
+		CXmlParser * parser = CXmlParser::NewL(*this, iTokenizer);
+		iIdleParsers.Append(parser); // Reserved above, cannot fail.
+		}
+	}
+
+/** Destructor, deletes the idle parsers. Parsers in use must have been released. */
+EXPORT_C CXmlParserPool::~CXmlParserPool()
+	{
+	iIdleParsers.ResetAndDestroy();
+	}
+
+/**
+ * Gets a parser from the pool, creating a new one if none is idle.
+ * @param aObserver The observer of the parser.
+ * @returns The parser, give it back with Release when done.
+ */
+EXPORT_C CXmlParser * CXmlParserPool::AcquireL(MXmlParserObserver & aObserver)
+	{
+	CXmlParser * parser = 0;
+	const TInt last = iIdleParsers.Count() - 1;
+	if (last >= 0)
+		{
+		parser = iIdleParsers[last];
+		iIdleParsers.Remove(last);
+		parser->SetObserver(aObserver);
+		}
+	else
+		{
+		parser = CXmlParser::NewL(aObserver, iTokenizer);
+		}
+	return parser;
+	}
+
+/**
+ * Gives a parser back to the pool. The parsing is stopped, and elements
+ * not retrieved from the parser are destroyed. The options of the parser
+ * are set back to the defaults.
+ * @param aParser The parser got from AcquireL.
+ */
+EXPORT_C void CXmlParserPool::Release(CXmlParser * aParser)
+	{
+	if (!aParser)
+		{
+		return;
+		}
+	aParser->Reset();
+	aParser->SetObserver(*this);
+	aParser->SetOptions(EXmlParseDefault);
+	aParser->SetFileWindowSize(KXmlDefaultFileWindowSize);
+	aParser->SetSliceBudget(0);
+	aParser->SetParallelism(KXmlDefaultParallelism);
+	aParser->SetSaxHandler(0);
+	aParser->ClearRecordObserver();
+	aParser->SetPathFilter(0);
+	aParser->SetElementHook(0);
+	if (iIdleParsers.Count() >= iMaxIdleCount || iIdleParsers.Append(aParser) != KErrNone)
+		{
+		delete aParser;
+		}
+	}
+
+/**
+ * Query the count of idle parsers in the pool.
+ * @returns The count of idle parsers.
+ */
+EXPORT_C TInt CXmlParserPool::IdleCount() const
+	{
+	return iIdleParsers.Count();
+	}
+
+/** Idle parsers do not parse, nothing to do. */
+void CXmlParserPool::FragmentParsedL()
+	{
+	}
+
+/** Idle parsers do not parse, nothing to do. */
+void CXmlParserPool::ParsingFinishedL(TInt /*aError*/)
+	{
+	}
+
+} // ajj
+} // org
@@ -0,0 +1,281 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include "XmlPathFilter.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** Separator of the names in a path. */
+const TText8 KXmlPathSeparator = '/';
+/** Separator of the namespace prefix and the name. */
+const TText8 KXmlPrefixSeparator = ':';
+_LIT8(KXmlPathWildcard, "*");
+
+/**
+ * Appends the names of a path to an array.
+ * @param aPath The path, without a leading slash.
+ * @param aNames The array, must have room for the names.
+ */
+LOCAL_C void AppendNamesL(const TDesC8 & aPath, RPointerArray<HBufC8> & aNames)
+	{
+	TPtrC8 rest(aPath);
+	FOREVER
+		{
+		const TInt separator = rest.Locate(KXmlPathSeparator);
+		const TPtrC8 name((separator == KErrNotFound) ? rest : rest.Left(separator));
+		if (name.Length() == 0)
+			{
+			User::Leave(KErrArgument);
+			}
+		aNames.AppendL(name.AllocL()); // Room was reserved, does not leave.
+		if (separator == KErrNotFound)
+			{
+			break;
+			}
+		rest.Set(rest.Mid(separator + 1));
+		}
+	}
+
+/**
+ * Creates an empty path filter.
+ * @returns The path filter.
+ */
+EXPORT_C CXmlPathFilter * CXmlPathFilter::NewL()
+	{
+	CXmlPathFilter * self = CXmlPathFilter::NewLC();
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/**
+ * Creates an empty path filter, leaving it to the cleanup stack.
+ * @returns The path filter.
+ */
+EXPORT_C CXmlPathFilter * CXmlPathFilter::NewLC()
+	{
+	CXmlPathFilter * self = new (ELeave) CXmlPathFilter;
+	CleanupStack::PushL(self);
+	return self;
+	}
+
+/** Constructor. */
+CXmlPathFilter::CXmlPathFilter()
+	{
+	}
+
+/** Destructor. */
+EXPORT_C CXmlPathFilter::~CXmlPathFilter()
+	{
+	iNames.ResetAndDestroy();
+	iFirstNames.Close();
+	iWildcardMasks.Close();
+	iEndMasks.Close();
+	iOpenMasks.Close();
+	}
+
+/**
+ * Adds a path of elements to select. Leaves with KErrOverflow if the
+ * filter has KXmlMaxFilterPaths paths already, and with KErrArgument
+ * if the path has an empty name.
+ * @param aPath The path, e.g. kml/Document/Placemark/name, in UTF-8.
+ */
+EXPORT_C void CXmlPathFilter::AddPathL(const TDesC8 & aPath)
+	{
+	const TInt path = iFirstNames.Count();
+	if (path >= KXmlMaxFilterPaths)
+		{
+		User::Leave(KErrOverflow);
+		}
+	TPtrC8 names(aPath);
+	if (names.Length() > 0 && names[0] == KXmlPathSeparator)
+		{
+		names.Set(names.Mid(1));
+		}
+	TInt depths = 1;
+	for (TInt index = 0; index < names.Length(); ++index)
+		{
+		if (names[index] == KXmlPathSeparator)
+			{
+			++depths;
+			}
+		}
+	// Reserve the memory first, so that the path is added as a whole or not at all.
+	iFirstNames.ReserveL(path + 1);
+	iNames.ReserveL(iNames.Count() + depths);
+	while (iEndMasks.Count() < depths)
+		{
+		iWildcardMasks.AppendL(0);
+		iEndMasks.AppendL(0);
+		}
+	const TInt first = iNames.Count();
+	TRAPD(error, AppendNamesL(names, iNames));
+	if (error != KErrNone)
+		{
+		for (TInt index = iNames.Count() - 1; index >= first; --index)
+			{
+			delete iNames[index];
+			iNames.Remove(index);
+			}
+		User::Leave(error);
+		}
+	const TUint32 bit = 1u << path;
+	for (TInt depth = 0; depth < depths; ++depth)
+		{
+		if (*iNames[first + depth] == KXmlPathWildcard)
+			{
+			iWildcardMasks[depth] |= bit;
+			}
+		}
+	iEndMasks[depths - 1] |= bit;
+	iFirstNames.AppendL(first); // Room was reserved, does not leave.
+	}
+
+/**
+ * Query the count of paths.
+ * @returns The count of paths added.
+ */
+EXPORT_C TInt CXmlPathFilter::Count() const
+	{
+	return iFirstNames.Count();
+	}
+
+/** Resets the matching for a new document. */
+void CXmlPathFilter::Reset()
+	{
+	iOpenMasks.Reset();
+	iSelectedDepth = 0;
+	iSkippedDepth = 0;
+	}
+
+/**
+ * Matches an element starting.
+ * @param aPrefix The namespace prefix of the element.
+ * @param aLocalName The name of the element without the prefix.
+ * @returns How the element matched.
+ */
+TXmlPathMatch CXmlPathFilter::StartElementL(const TDesC8 & aPrefix, const TDesC8 & aLocalName)
+	{
+	if (iSkippedDepth > 0)
+		{
+		++iSkippedDepth;
+		return EXmlPathSkip;
+		}
+	if (iSelectedDepth > 0)
+		{
+		++iSelectedDepth;
+		return EXmlPathSelected;
+		}
+	const TInt depth = iOpenMasks.Count();
+	if (depth >= iEndMasks.Count())
+		{
+		iSkippedDepth = 1;
+		return EXmlPathSkip;
+		}
+	const TInt paths = iFirstNames.Count();
+	const TUint32 candidates = (depth > 0) ? iOpenMasks[depth - 1]
+			: ((paths == KXmlMaxFilterPaths) ? KMaxTUint32 : (1u << paths) - 1);
+	TUint32 matched = candidates & iWildcardMasks[depth];
+	TUint32 rest = candidates & ~matched;
+	for (TInt path = 0; rest != 0; ++path)
+		{
+		const TUint32 bit = 1u << path;
+		if (rest & bit)
+			{
+			rest &= ~bit;
+			if (Matches(path, depth, aPrefix, aLocalName))
+				{
+				matched |= bit;
+				}
+			}
+		}
+	if (!matched)
+		{
+		iSkippedDepth = 1;
+		return EXmlPathSkip;
+		}
+	if (matched & iEndMasks[depth])
+		{
+		iSelectedDepth = 1;
+		return EXmlPathSelected;
+		}
+	iOpenMasks.AppendL(matched);
+	return EXmlPathAncestor;
+	}
+
+/**
+ * Matches an element ending.
+ * @returns EFalse if the element was skipped.
+ */
+TBool CXmlPathFilter::EndElement()
+	{
+	if (iSkippedDepth > 0)
+		{
+		--iSkippedDepth;
+		return EFalse;
+		}
+	if (iSelectedDepth > 0)
+		{
+		--iSelectedDepth;
+		}
+	else if (iOpenMasks.Count() > 0)
+		{
+		iOpenMasks.Remove(iOpenMasks.Count() - 1);
+		}
+	return ETrue;
+	}
+
+/**
+ * Query if the current element is kept as a whole.
+ * @returns ETrue inside a selected element.
+ */
+TBool CXmlPathFilter::IsSelected() const
+	{
+	return iSkippedDepth == 0 && iSelectedDepth > 0;
+	}
+
+/**
+ * Compares an element with a name of a path.
+ * @param aPath The path.
+ * @param aDepth The depth of the element, and the name in the path.
+ * @param aPrefix The namespace prefix of the element.
+ * @param aLocalName The name of the element without the prefix.
+ * @returns ETrue if the element matches the name.
+ */
+TBool CXmlPathFilter::Matches(TInt aPath, TInt aDepth, const TDesC8 & aPrefix, const TDesC8 & aLocalName) const
+	{
+	const TDesC8 & name = *iNames[iFirstNames[aPath] + aDepth];
+	const TInt separator = name.Locate(KXmlPrefixSeparator);
+	if (separator == KErrNotFound)
+		{
+		return name == aLocalName;
+		}
+	return name.Left(separator) == aPrefix && name.Mid(separator + 1) == aLocalName;
+	}
+
+} // ajj
+} // org
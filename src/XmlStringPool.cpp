@@ -0,0 +1,140 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include "XmlStringPool.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/**
+ * Creates an empty pool, open once for the caller.
+ * @returns The pool, close it with Close().
+ */
+EXPORT_C CXmlStringPool * CXmlStringPool::NewL()
+	{
+	return new (ELeave) CXmlStringPool;
+	}
+
+/** Constructor, the creator holds the pool. */
+CXmlStringPool::CXmlStringPool()
+: iAccessCount(1)
+	{
+	}
+
+/** Destructor, destroys the names. */
+CXmlStringPool::~CXmlStringPool()
+	{
+	iStrings.ResetAndDestroy();
+	}
+
+/** Opens the pool once more, for one more holder. */
+EXPORT_C void CXmlStringPool::Open()
+	{
+	User::LockedInc(iAccessCount);
+	}
+
+/** Closes the pool once, destroying it when the last holder closes it. */
+EXPORT_C void CXmlStringPool::Close()
+	{
+	// LockedDec returns the count before decrementing.
+	if (User::LockedDec(iAccessCount) == 1)
+		{
+		delete this;
+		}
+	}
+
+/**
+ * Interns a name, adding it to the pool if not there yet.
+ * @param aString The name.
+ * @returns The pooled name, valid as long as the pool.
+ */
+EXPORT_C const HBufC8 * CXmlStringPool::InternL(const TDesC8 & aString)
+	{
+	TInt index = 0;
+	if (!FindIndex(aString, index))
+		{
+		HBufC8 * string = aString.AllocLC();
+		iStrings.InsertL(string, index);
+		CleanupStack::Pop(string);
+		}
+	return iStrings[index];
+	}
+
+/**
+ * Finds a name in the pool, without adding it.
+ * @param aString The name.
+ * @returns The pooled name, 0 if the name is not in the pool.
+ */
+EXPORT_C const HBufC8 * CXmlStringPool::Find(const TDesC8 & aString) const
+	{
+	TInt index = 0;
+	return FindIndex(aString, index) ? iStrings[index] : 0;
+	}
+
+/**
+ * Gives the count of the names in the pool.
+ * @returns The count of the names.
+ */
+EXPORT_C TInt CXmlStringPool::Count() const
+	{
+	return iStrings.Count();
+	}
+
+/**
+ * Finds the position of a name in the ordered names.
+ * @param aString The name.
+ * @param aIndex Set to the index of the name, or of where it would be inserted.
+ * @returns ETrue if the name is in the pool.
+ */
+TBool CXmlStringPool::FindIndex(const TDesC8 & aString, TInt & aIndex) const
+	{
+	TInt low = 0;
+	TInt high = iStrings.Count();
+	while (low < high)
+		{
+		const TInt middle = (low + high) / 2;
+		const TInt result = aString.Compare(*iStrings[middle]);
+		if (result == 0)
+			{
+			aIndex = middle;
+			return ETrue;
+			}
+		if (result < 0)
+			{
+			high = middle;
+			}
+		else
+			{
+			low = middle + 1;
+			}
+		}
+	aIndex = low;
+	return EFalse;
+	}
+
+} // ajj
+} // org
@@ -0,0 +1,977 @@
+/*
+ * $Id: $
+ *
+ * Created 2026/10/17
+ *
+ * Version: LGPL 3
+ *
+ * This file is part of XMLParser dll.
+ *
+ * XMLParser is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * XMLParser is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with XMLParser.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright (C) 2008 University of Oulu, Antti Juustila (antti)
+ */
+
+#include "XmlTokenizer.h"
+#include "XMLParserConstants.h"
+#include "ConversionUtils.h"
+
+namespace org
+{
+namespace ajj
+{
+
+/** The literal given to MatchStart is at the start of the data. */
+const TInt KMatch = 1;
+/** The literal given to MatchStart is not at the start of the data. */
+const TInt KNoMatch = 0;
+/** The data given to MatchStart is too short to tell. */
+const TInt KNeedMore = -1;
+
+_LIT8(KUtf8CharacterSet, "UTF-8");
+
+/** Query if a byte is XML whitespace. */
+LOCAL_C TBool IsWhitespace(TUint8 aByte)
+	{
+	return aByte == ' ' || aByte == '\n' || aByte == '\r' || aByte == '\t';
+	}
+
+/** Query if a byte ends a name in a tag. */
+LOCAL_C TBool IsNameEnd(TUint8 aByte)
+	{
+	return IsWhitespace(aByte) || aByte == '/' || aByte == '>' || aByte == '=';
+	}
+
+/**
+ * Checks if data starts with a literal.
+ * @returns KMatch, KNoMatch, or KNeedMore if the data is a start of the literal.
+ */
+LOCAL_C TInt MatchStart(const TDesC8 & aData, const TDesC8 & aLiteral)
+	{
+	const TInt length = Min(aData.Length(), aLiteral.Length());
+	if (aData.Left(length) != aLiteral.Left(length))
+		{
+		return KNoMatch;
+		}
+	return length == aLiteral.Length() ? KMatch : KNeedMore;
+	}
+
+/**
+ * Creates a new tokenizer.
+ * @param aHandler The handler the XML is reported to.
+ * @returns The tokenizer object.
+ */
+EXPORT_C CXmlTokenizer * CXmlTokenizer::NewL(Xml::MContentHandler & aHandler)
+	{
+	CXmlTokenizer * self = new (ELeave) CXmlTokenizer(aHandler);
+	CleanupStack::PushL(self);
+	self->ConstructL();
+	CleanupStack::Pop(self);
+	return self;
+	}
+
+/** Constructor, initializes the member variables. */
+CXmlTokenizer::CXmlTokenizer(Xml::MContentHandler & aHandler)
+: iHandler(aHandler)
+	{
+	}
+
+/** 2nd phase constructor, opens the string pool. */
+void CXmlTokenizer::ConstructL()
+	{
+	iStringPool.OpenL();
+	}
+
+/** Destructor, releases the strings and the buffers. */
+EXPORT_C CXmlTokenizer::~CXmlTokenizer()
+	{
+	ResetMappings();
+	iMappings.Close();
+	CleanupAttributes(this);
+	iAttributes.Close();
+	iRawAttributes.Close();
+	iPending.Close();
+	iOpenNames.Close();
+	iOpenNameOffsets.Close();
+	iDecoded.Close();
+	iStringPool.Close();
+	}
+
+/**
+ * Query the string pool the names are reported from.
+ * @returns The string pool.
+ */
+EXPORT_C RStringPool & CXmlTokenizer::StringPool()
+	{
+	return iStringPool;
+	}
+
+/**
+ * Begins a new document. The buffers keep their memory from the previous one.
+ */
+EXPORT_C void CXmlTokenizer::ParseBeginL()
+	{
+	ResetMappings();
+	iPending.Zero();
+	iPendingEndSearch = 0;
+	iOpenNames.Zero();
+	iOpenNameOffsets.Reset();
+	iDepth = 0;
+	iSkipDepth = 0;
+	iSkipRequested = EFalse;
+	iDocumentStarted = EFalse;
+	iFailed = EFalse;
+	}
+
+/**
+ * Skips the content of the element starting. Call from the
+ * MContentHandler::OnStartElementL of the element. The content up to the
+ * matching end tag is scanned only for the nesting of the elements in it:
+ * nothing is reported, allocated or decoded. The end of the element is
+ * reported as usual.
+ */
+EXPORT_C void CXmlTokenizer::SkipElement()
+	{
+	iSkipRequested = ETrue;
+	}
+
+/**
+ * Parses a piece of the document. The pieces can be split anywhere.
+ * Leaves if the handler leaves, errors in the XML are reported with
+ * MContentHandler::OnError, after which the rest of the document is ignored.
+ * @param aChunk The next piece of the document.
+ */
+EXPORT_C void CXmlTokenizer::ParseL(const TDesC8 & aChunk)
+	{
+	if (iFailed)
+		{
+		return;
+		}
+	if (!iDocumentStarted)
+		{
+		StartDocumentL();
+		}
+	TPtrC8 rest(aChunk);
+	// First complete the token split by the end of the previous piece.
+	while (iPending.Length() > 0 && rest.Length() > 0 && !iFailed)
+		{
+		if (iPending[0] != '<')
+			{
+			// Content ends where the next markup starts.
+			const TInt end = ConversionUtils::FindByte(rest, '<');
+			if (end == KErrNotFound)
+				{
+				AppendPendingL(rest);
+				return;
+				}
+			AppendPendingL(rest.Left(end));
+			rest.Set(rest.Mid(end));
+			ContentL(iPending);
+			iPending.Zero();
+			}
+		else
+			{
+			// Markup ends at a '>', though not necessarily at the next one.
+			const TInt end = ConversionUtils::FindByte(rest, '>');
+			if (end == KErrNotFound)
+				{
+				AppendPendingL(rest);
+				return;
+				}
+			AppendPendingL(rest.Left(end + 1));
+			rest.Set(rest.Mid(end + 1));
+			TInt start = 0;
+			const TDesC8 * markupEnd = PendingMarkupEnd(start);
+			if (markupEnd)
+				{
+				// Search only the bytes not searched yet, and the ones before
+				// them an end marker split by the previous piece may start in.
+				start = Max(start, iPendingEndSearch);
+				if (iPending.Mid(start).Find(*markupEnd) == KErrNotFound)
+					{
+					iPendingEndSearch = Max(start, iPending.Length() - markupEnd->Length() + 1);
+					continue;
+					}
+				}
+			const TInt used = NextMarkupL(iPending);
+			if (used != KErrNotFound)
+				{
+				iPending.Delete(0, used);
+				iPendingEndSearch = 0;
+				}
+			}
+		}
+	if (iFailed || rest.Length() == 0)
+		{
+		return;
+		}
+	const TInt used = TokenizeL(rest, EFalse);
+	if (used < rest.Length() && !iFailed)
+		{
+		AppendPendingL(rest.Mid(used));
+		}
+	}
+
+/**
+ * Ends the document. Reports an error if the document ended
+ * in the middle of markup, or before the root element ended.
+ */
+EXPORT_C void CXmlTokenizer::ParseEndL()
+	{
+	if (!iFailed)
+		{
+		if (!iDocumentStarted)
+			{
+			StartDocumentL();
+			}
+		if (iPending.Length() > 0)
+			{
+			if (iPending[0] == '<')
+				{
+				Error(KErrCorrupt, 0);
+				}
+			else
+				{
+				ContentL(iPending);
+				}
+			iPending.Zero();
+			}
+		if (!iFailed && iDepth > 0)
+			{
+			Error(KErrCorrupt, 0);
+			}
+		if (!iFailed)
+			{
+			iHandler.OnEndDocumentL(KErrNone);
+			}
+		}
+	ResetMappings();
+	iPending.Zero();
+	iPendingEndSearch = 0;
+	iOpenNames.Zero();
+	iOpenNameOffsets.Reset();
+	iDepth = 0;
+	iSkipDepth = 0;
+	}
+
+/**
+ * Reports the complete tokens in the data.
+ * @param aData The data.
+ * @param aFinal ETrue if no more data follows, so content at the end is complete.
+ * @returns The count of bytes used, the rest is an incomplete token.
+ */
+TInt CXmlTokenizer::TokenizeL(const TDesC8 & aData, TBool aFinal)
+	{
+	const TInt length = aData.Length();
+	TInt pos = 0;
+	while (pos < length && !iFailed)
+		{
+		TPtrC8 rest(aData.Mid(pos));
+		TInt used = 0;
+		if (rest[0] == '<')
+			{
+			used = NextMarkupL(rest);
+			if (used == KErrNotFound)
+				{
+				break;
+				}
+			}
+		else
+			{
+			used = ConversionUtils::FindByte(rest, '<');
+			if (iSkipDepth > 0)
+				{
+				// Skipped content is not kept even if it continues in the next piece.
+				used = (used == KErrNotFound) ? rest.Length() : used;
+				}
+			else
+				{
+				if (used == KErrNotFound)
+					{
+					if (!aFinal)
+						{
+						break;
+						}
+					used = rest.Length();
+					}
+				ContentL(rest.Left(used));
+				}
+			}
+		pos += used;
+		}
+	return pos;
+	}
+
+/**
+ * Reports the markup at the start of the data.
+ * @param aData Data starting with '<'.
+ * @returns The length of the markup, KErrNotFound if it is not complete.
+ */
+TInt CXmlTokenizer::MarkupL(const TDesC8 & aData)
+	{
+	if (aData.Length() < 2)
+		{
+		return KErrNotFound;
+		}
+	switch (aData[1])
+		{
+		case '/':
+			{
+			const TInt end = ConversionUtils::FindByte(aData, '>');
+			if (end == KErrNotFound)
+				{
+				return KErrNotFound;
+				}
+			EndElementL(aData.Mid(2, end - 2));
+			return end + 1;
+			}
+		case '?':
+			{
+			const TInt end = aData.Mid(2).Find(KProcessingInstructionEnd8);
+			if (end == KErrNotFound)
+				{
+				return KErrNotFound;
+				}
+			ProcessingInstructionL(aData.Mid(2, end));
+			return 2 + end + KProcessingInstructionEnd8().Length();
+			}
+		case '!':
+			return DeclarationL(aData);
+		default:
+			return StartTagL(aData);
+		}
+	}
+
+/**
+ * Handles the markup at the start of the data, reporting
+ * it, or skipping it inside a skipped element.
+ * @param aData Data starting with '<'.
+ * @returns The length of the markup, KErrNotFound if it is not complete.
+ */
+TInt CXmlTokenizer::NextMarkupL(const TDesC8 & aData)
+	{
+	return (iSkipDepth > 0) ? SkipMarkupL(aData) : MarkupL(aData);
+	}
+
+/**
+ * Skips the markup at the start of the data inside a skipped element,
+ * counting only the start and end tags. Reports the end of the skipped
+ * element when its end tag is found.
+ * @param aData Data starting with '<'.
+ * @returns The length of the markup, KErrNotFound if it is not complete.
+ */
+TInt CXmlTokenizer::SkipMarkupL(const TDesC8 & aData)
+	{
+	if (aData.Length() < 2)
+		{
+		return KErrNotFound;
+		}
+	if (aData[1] == '/')
+		{
+		const TInt end = ConversionUtils::FindByte(aData, '>');
+		if (end == KErrNotFound)
+			{
+			return KErrNotFound;
+			}
+		if (--iSkipDepth == 0)
+			{
+			EndElementL(aData.Mid(2, end - 2));
+			}
+		return end + 1;
+		}
+	if (aData[1] == '?')
+		{
+		const TInt end = aData.Mid(2).Find(KProcessingInstructionEnd8);
+		return end == KErrNotFound ? KErrNotFound : 2 + end + KProcessingInstructionEnd8().Length();
+		}
+	if (aData[1] == '!')
+		{
+		TInt match = MatchStart(aData, KCommentStart8);
+		if (match == KNeedMore)
+			{
+			return KErrNotFound;
+			}
+		const TDesC8 * endMarker = 0;
+		TInt start = 2;
+		if (match == KMatch)
+			{
+			endMarker = &KCommentEnd8();
+			start = KCommentStart8().Length();
+			}
+		else
+			{
+			match = MatchStart(aData, KCDataStart8);
+			if (match == KNeedMore)
+				{
+				return KErrNotFound;
+				}
+			if (match == KMatch)
+				{
+				endMarker = &KCDataEnd8();
+				start = KCDataStart8().Length();
+				}
+			}
+		if (!endMarker)
+			{
+			const TInt end = ConversionUtils::FindByte(aData, '>');
+			return end == KErrNotFound ? KErrNotFound : end + 1;
+			}
+		const TInt end = aData.Mid(start).Find(*endMarker);
+		return end == KErrNotFound ? KErrNotFound : start + end + endMarker->Length();
+		}
+	// A start tag, which may have a '>' in its attribute values.
+	TUint8 quote = 0;
+	for (TInt pos = 1; pos < aData.Length(); ++pos)
+		{
+		const TUint8 byte = aData[pos];
+		if (quote)
+			{
+			if (byte == quote)
+				{
+				quote = 0;
+				}
+			}
+		else if (byte == '"' || byte == '\'')
+			{
+			quote = byte;
+			}
+		else if (byte == '>')
+			{
+			if (aData[pos - 1] != '/')
+				{
+				++iSkipDepth;
+				}
+			return pos + 1;
+			}
+		}
+	return KErrNotFound;
+	}
+
+/**
+ * Reports the start tag at the start of the data. The attributes are
+ * collected first, so nothing is reported if the tag is not complete.
+ * @param aData Data starting with '<'.
+ * @returns The length of the tag, KErrNotFound if it is not complete.
+ */
+TInt CXmlTokenizer::StartTagL(const TDesC8 & aData)
+	{
+	const TInt length = aData.Length();
+	TInt pos = 1;
+	while (pos < length && !IsNameEnd(aData[pos]))
+		{
+		++pos;
+		}
+	if (pos >= length)
+		{
+		return KErrNotFound;
+		}
+	TPtrC8 name(aData.Mid(1, pos - 1));
+	if (name.Length() == 0)
+		{
+		return Error(KErrCorrupt, length);
+		}
+
+	for (TInt index = iRawAttributes.Count() - 1; index >= 0; --index)
+		{
+		iRawAttributes.Remove(index);
+		}
+	TBool isEmpty = EFalse;
+	FOREVER
+		{
+		while (pos < length && IsWhitespace(aData[pos]))
+			{
+			++pos;
+			}
+		if (pos >= length)
+			{
+			return KErrNotFound;
+			}
+		if (aData[pos] == '>')
+			{
+			++pos;
+			break;
+			}
+		if (aData[pos] == '/')
+			{
+			if (pos + 1 >= length)
+				{
+				return KErrNotFound;
+				}
+			if (aData[pos + 1] != '>')
+				{
+				return Error(KErrCorrupt, length);
+				}
+			isEmpty = ETrue;
+			pos += 2;
+			break;
+			}
+
+		TXmlRawAttribute attribute;
+		const TInt nameStart = pos;
+		while (pos < length && !IsNameEnd(aData[pos]))
+			{
+			++pos;
+			}
+		attribute.iName.Set(aData.Mid(nameStart, pos - nameStart));
+		while (pos < length && IsWhitespace(aData[pos]))
+			{
+			++pos;
+			}
+		if (pos >= length)
+			{
+			return KErrNotFound;
+			}
+		if (aData[pos] != '=' || attribute.iName.Length() == 0)
+			{
+			return Error(KErrCorrupt, length);
+			}
+		++pos;
+		while (pos < length && IsWhitespace(aData[pos]))
+			{
+			++pos;
+			}
+		if (pos >= length)
+			{
+			return KErrNotFound;
+			}
+		const TUint8 quote = aData[pos];
+		if (quote != '"' && quote != '\'')
+			{
+			return Error(KErrCorrupt, length);
+			}
+		const TInt valueLength = ConversionUtils::FindByte(aData.Mid(pos + 1), quote);
+		if (valueLength == KErrNotFound)
+			{
+			return KErrNotFound;
+			}
+		attribute.iValue.Set(aData.Mid(pos + 1, valueLength));
+		iRawAttributes.AppendL(attribute);
+		pos += valueLength + 2;
+		}
+	StartElementL(name, isEmpty);
+	return pos;
+	}
+
+/**
+ * Handles the markup starting with "<!": a comment, a CDATA section or
+ * a document type declaration. CDATA is reported as content with its
+ * markers, which CXmlElement removes, marking the value as CDATA.
+ * @param aData Data starting with "<!".
+ * @returns The length of the markup, KErrNotFound if it is not complete.
+ */
+TInt CXmlTokenizer::DeclarationL(const TDesC8 & aData)
+	{
+	TInt match = MatchStart(aData, KCommentStart8);
+	if (match == KNeedMore)
+		{
+		return KErrNotFound;
+		}
+	if (match == KMatch)
+		{
+		const TInt start = KCommentStart8().Length();
+		const TInt end = aData.Mid(start).Find(KCommentEnd8);
+		return end == KErrNotFound ? KErrNotFound : start + end + KCommentEnd8().Length();
+		}
+
+	match = MatchStart(aData, KCDataStart8);
+	if (match == KNeedMore)
+		{
+		return KErrNotFound;
+		}
+	if (match == KMatch)
+		{
+		const TInt start = KCDataStart8().Length();
+		const TInt end = aData.Mid(start).Find(KCDataEnd8);
+		if (end == KErrNotFound)
+			{
+			return KErrNotFound;
+			}
+		const TInt used = start + end + KCDataEnd8().Length();
+		if (iDepth > 0)
+			{
+			iHandler.OnContentL(aData.Left(used), KErrNone);
+			}
+		return used;
+		}
+
+	// A document type declaration, skipped with its internal subset.
+	TInt bracketDepth = 0;
+	TUint8 quote = 0;
+	for (TInt pos = 2; pos < aData.Length(); ++pos)
+		{
+		const TUint8 byte = aData[pos];
+		if (quote)
+			{
+			if (byte == quote)
+				{
+				quote = 0;
+				}
+			}
+		else if (byte == '"' || byte == '\'')
+			{
+			quote = byte;
+			}
+		else if (byte == '[')
+			{
+			++bracketDepth;
+			}
+		else if (byte == ']')
+			{
+			--bracketDepth;
+			}
+		else if (byte == '>' && bracketDepth <= 0)
+			{
+			return pos + 1;
+			}
+		}
+	return KErrNotFound;
+	}
+
+/**
+ * Reports a processing instruction. The XML declaration is not reported.
+ * @param aInstruction The instruction between "<?" and "?>".
+ */
+void CXmlTokenizer::ProcessingInstructionL(const TDesC8 & aInstruction)
+	{
+	TInt pos = 0;
+	while (pos < aInstruction.Length() && !IsWhitespace(aInstruction[pos]))
+		{
+		++pos;
+		}
+	TPtrC8 target(aInstruction.Left(pos));
+	if (target.CompareF(KXmlDeclarationTarget8) == 0)
+		{
+		return;
+		}
+	while (pos < aInstruction.Length() && IsWhitespace(aInstruction[pos]))
+		{
+		++pos;
+		}
+	iHandler.OnProcessingInstructionL(target, aInstruction.Mid(pos), KErrNone);
+	}
+
+/** Reports the start of the document, in UTF-8. */
+void CXmlTokenizer::StartDocumentL()
+	{
+	iDocumentStarted = ETrue;
+	RString characterSet = iStringPool.OpenStringL(KUtf8CharacterSet);
+	Xml::RDocumentParameters parameters;
+	parameters.Open(characterSet);
+	CleanupClosePushL(parameters);
+	iHandler.OnStartDocumentL(parameters, KErrNone);
+	CleanupStack::PopAndDestroy(); // parameters
+	}
+
+/**
+ * Reports the start of an element, with the namespace declarations
+ * and the attributes collected in iRawAttributes.
+ * @param aName The qualified name of the element.
+ * @param aIsEmpty ETrue if the tag was an empty element tag.
+ */
+void CXmlTokenizer::StartElementL(const TDesC8 & aName, TBool aIsEmpty)
+	{
+	// The name is kept for checking the end tag, the input may be gone by then.
+	const TInt length = iOpenNames.Length() + aName.Length();
+	if (length > iOpenNames.MaxLength())
+		{
+		iOpenNames.ReAllocL(Max(length, iOpenNames.MaxLength() * 2));
+		}
+	iOpenNameOffsets.AppendL(iOpenNames.Length());
+	iOpenNames.Append(aName);
+	++iDepth;
+	// The namespaces first, the names of the element and its attributes may use them.
+	const TInt count = iRawAttributes.Count();
+	for (TInt index = 0; index < count; ++index)
+		{
+		const TXmlRawAttribute & raw = iRawAttributes[index];
+		const TBool isDefault = raw.iName == KXmlNs;
+		if (isDefault || MatchStart(raw.iName, KXmlNsPrefix8) == KMatch)
+			{
+			TPtrC8 prefix(KNullDesC8);
+			if (!isDefault)
+				{
+				prefix.Set(raw.iName.Mid(KXmlNsPrefix8().Length()));
+				}
+			TXmlNamespaceMapping mapping;
+			mapping.iPrefix = iStringPool.OpenStringL(prefix);
+			CleanupClosePushL(mapping.iPrefix);
+			mapping.iUri = iStringPool.OpenStringL(DecodeL(raw.iValue));
+			CleanupClosePushL(mapping.iUri);
+			mapping.iDepth = iDepth;
+			iMappings.AppendL(mapping);
+			CleanupStack::Pop(2); // mapping.iUri, mapping.iPrefix
+			iHandler.OnStartPrefixMappingL(mapping.iPrefix, mapping.iUri, KErrNone);
+			}
+		}
+
+	Xml::RTagInfo tagInfo;
+	OpenTagInfoL(tagInfo, aName, EFalse);
+	CleanupClosePushL(tagInfo);
+	CleanupStack::PushL(TCleanupItem(CleanupAttributes, this));
+	for (TInt index = 0; index < count; ++index)
+		{
+		const TXmlRawAttribute & raw = iRawAttributes[index];
+		if (raw.iName == KXmlNs || MatchStart(raw.iName, KXmlNsPrefix8) == KMatch)
+			{
+			continue;
+			}
+		Xml::RTagInfo attributeName;
+		OpenTagInfoL(attributeName, raw.iName, ETrue);
+		CleanupClosePushL(attributeName);
+		RString value = iStringPool.OpenStringL(DecodeL(raw.iValue));
+		CleanupStack::Pop(); // attributeName, owned by the attribute from now on
+		Xml::RAttribute attribute;
+		attribute.Open(attributeName.Uri(), attributeName.Prefix(), attributeName.LocalName(), value);
+		TInt error = iAttributes.Append(attribute);
+		if (error != KErrNone)
+			{
+			attribute.Close();
+			User::Leave(error);
+			}
+		}
+	iSkipRequested = EFalse;
+	iHandler.OnStartElementL(tagInfo, iAttributes, KErrNone);
+	CleanupStack::PopAndDestroy(2); // attributes, tagInfo
+	if (aIsEmpty)
+		{
+		EndElementL(aName);
+		}
+	else if (iSkipRequested)
+		{
+		iSkipDepth = 1;
+		}
+	iSkipRequested = EFalse;
+	}
+
+/**
+ * Reports the end of an element, and the end of the namespaces it declared.
+ * @param aName The qualified name of the element.
+ */
+void CXmlTokenizer::EndElementL(const TDesC8 & aName)
+	{
+	TPtrC8 name(aName);
+	while (name.Length() > 0 && IsWhitespace(name[name.Length() - 1]))
+		{
+		name.Set(name.Left(name.Length() - 1));
+		}
+	if (iDepth == 0)
+		{
+		Error(KErrCorrupt, 0);
+		return;
+		}
+	const TInt last = iOpenNameOffsets.Count() - 1;
+	if (iOpenNames.Mid(iOpenNameOffsets[last]) != name)
+		{
+		// The end tag does not match the start tag.
+		Error(KErrCorrupt, 0);
+		return;
+		}
+	Xml::RTagInfo tagInfo;
+	OpenTagInfoL(tagInfo, name, EFalse);
+	CleanupClosePushL(tagInfo);
+	iHandler.OnEndElementL(tagInfo, KErrNone);
+	CleanupStack::PopAndDestroy(); // tagInfo
+	EndMappingsL(iDepth);
+	iOpenNames.SetLength(iOpenNameOffsets[last]);
+	iOpenNameOffsets.Remove(last);
+	--iDepth;
+	}
+
+/**
+ * Reports content. Content outside the root element is whitespace
+ * between the markup, and is not reported.
+ * @param aContent The content, references not decoded.
+ */
+void CXmlTokenizer::ContentL(const TDesC8 & aContent)
+	{
+	if (iDepth > 0)
+		{
+		iHandler.OnContentL(DecodeL(aContent), KErrNone);
+		}
+	}
+
+/**
+ * Opens a tag info for a qualified name, resolving the namespace URI
+ * of the prefix. Attributes without a prefix have no namespace.
+ * @param aTagInfo The tag info to open.
+ * @param aName The qualified name.
+ * @param aIsAttribute ETrue if the name is an attribute name.
+ */
+void CXmlTokenizer::OpenTagInfoL(Xml::RTagInfo & aTagInfo, const TDesC8 & aName, TBool aIsAttribute)
+	{
+	TPtrC8 prefix(KNullDesC8);
+	TPtrC8 localName(aName);
+	const TInt colon = aName.Locate(':');
+	if (colon != KErrNotFound)
+		{
+		prefix.Set(aName.Left(colon));
+		localName.Set(aName.Mid(colon + 1));
+		}
+	TInt mapping = KErrNotFound;
+	if (!aIsAttribute || prefix.Length() > 0)
+		{
+		for (mapping = iMappings.Count() - 1; mapping >= 0; --mapping)
+			{
+			if (iMappings[mapping].iPrefix.DesC() == prefix)
+				{
+				break;
+				}
+			}
+		}
+	RString uri;
+	if (mapping >= 0)
+		{
+		uri = iMappings[mapping].iUri.Copy();
+		}
+	else
+		{
+		uri = iStringPool.OpenStringL(KNullDesC8);
+		}
+	CleanupClosePushL(uri);
+	RString prefixString = iStringPool.OpenStringL(prefix);
+	CleanupClosePushL(prefixString);
+	RString localNameString = iStringPool.OpenStringL(localName);
+	CleanupStack::Pop(2); // prefixString, uri
+	aTagInfo.Open(uri, prefixString, localNameString);
+	}
+
+/**
+ * Decodes the references in content or an attribute value.
+ * @param aRaw The content or value.
+ * @returns The decoded data, aRaw itself if it has no references.
+ * Valid until the next call.
+ */
+TPtrC8 CXmlTokenizer::DecodeL(const TDesC8 & aRaw)
+	{
+	TInt ampersand = ConversionUtils::FindByte(aRaw, '&');
+	if (ampersand == KErrNotFound)
+		{
+		return aRaw;
+		}
+	if (iDecoded.MaxLength() < aRaw.Length())
+		{
+		iDecoded.ReAllocL(aRaw.Length());
+		}
+	iDecoded.Zero();
+	TPtrC8 rest(aRaw);
+	while (ampersand != KErrNotFound)
+		{
+		iDecoded.Append(rest.Left(ampersand));
+		rest.Set(rest.Mid(ampersand));
+		rest.Set(rest.Mid(ConversionUtils::AppendReference(rest, iDecoded)));
+		ampersand = ConversionUtils::FindByte(rest, '&');
+		}
+	iDecoded.Append(rest);
+	return iDecoded;
+	}
+
+/**
+ * Keeps data of a token split by the end of the input.
+ * @param aData The data to keep.
+ */
+void CXmlTokenizer::AppendPendingL(const TDesC8 & aData)
+	{
+	const TInt length = iPending.Length() + aData.Length();
+	if (length > iPending.MaxLength())
+		{
+		iPending.ReAllocL(Max(length, iPending.MaxLength() * 2));
+		}
+	iPending.Append(aData);
+	}
+
+/**
+ * Gives the end marker of the markup in iPending, if it is a comment,
+ * a CDATA section or a processing instruction, which may have '>'
+ * characters before their end.
+ * @param aStart Set to the offset after the start marker.
+ * @returns The end marker, 0 for other markup or if not known yet.
+ */
+const TDesC8 * CXmlTokenizer::PendingMarkupEnd(TInt & aStart) const
+	{
+	if (iPending.Length() >= 2 && iPending[1] == '?')
+		{
+		aStart = 2;
+		return &KProcessingInstructionEnd8();
+		}
+	if (MatchStart(iPending, KCommentStart8) == KMatch)
+		{
+		aStart = KCommentStart8().Length();
+		return &KCommentEnd8();
+		}
+	if (MatchStart(iPending, KCDataStart8) == KMatch)
+		{
+		aStart = KCDataStart8().Length();
+		return &KCDataEnd8();
+		}
+	return 0;
+	}
+
+/**
+ * Reports an error in the XML. The rest of the document is ignored.
+ * @param aError The error code.
+ * @param aUsed Returned as is.
+ * @returns aUsed, the count of bytes to skip.
+ */
+TInt CXmlTokenizer::Error(TInt aError, TInt aUsed)
+	{
+	iFailed = ETrue;
+	iHandler.OnError(aError);
+	return aUsed;
+	}
+
+/**
+ * Reports the end of the namespaces declared at a depth.
+ * @param aDepth Depth of the element ending.
+ */
+void CXmlTokenizer::EndMappingsL(TInt aDepth)
+	{
+	for (TInt last = iMappings.Count() - 1; last >= 0 && iMappings[last].iDepth >= aDepth; --last)
+		{
+		TXmlNamespaceMapping mapping = iMappings[last];
+		iMappings.Remove(last);
+		CleanupClosePushL(mapping.iPrefix);
+		CleanupClosePushL(mapping.iUri);
+		iHandler.OnEndPrefixMappingL(mapping.iPrefix, KErrNone);
+		CleanupStack::PopAndDestroy(2); // mapping.iUri, mapping.iPrefix
+		}
+	}
+
+/** Closes the namespaces in scope without reporting them. */
+void CXmlTokenizer::ResetMappings()
+	{
+	for (TInt last = iMappings.Count() - 1; last >= 0; --last)
+		{
+		iMappings[last].iPrefix.Close();
+		iMappings[last].iUri.Close();
+		iMappings.Remove(last);
+		}
+	}
+
+/**
+ * Closes and removes the attributes reported, keeping the memory of the array.
+ * Used as a cleanup item.
+ * @param aTokenizer The tokenizer.
+ */
+void CXmlTokenizer::CleanupAttributes(TAny * aTokenizer)
+	{
+	Xml::RAttributeArray & attributes = static_cast<CXmlTokenizer *>(aTokenizer)->iAttributes;
+	for (TInt last = attributes.Count() - 1; last >= 0; --last)
+		{
+		attributes[last].Close();
+		attributes.Remove(last);
+		}
+	}
+
+} // ajj
+} // org